@@ -0,0 +1,40 @@
+#!/bin/bash
+# vim: set sw=4 sts=4 et :
+
+# Times some search-heavy runs, with and without writing a proof, and prints
+# the runtime of each in milliseconds. Give a different solver as the first
+# argument to compare two builds, such as one built from the previous commit.
+# Each run with --prove uses the same limits as the run without it before it,
+# so the two can be compared directly.
+
+solver=${1:-./certified_constraint_solver}
+scratch=$(mktemp -d)
+trap 'rm -rf $scratch' EXIT
+
+# pigeons into holes, using only notequal constraints
+for i in 1 2 3 4 5 6 7 8 9 ; do echo "intvar p$i 1 8" ; done > $scratch/pigeons.model
+for i in 1 2 3 4 5 6 7 8 9 ; do for j in 1 2 3 4 5 6 7 8 9 ; do
+    [[ $i -lt $j ]] && echo "notequal p$i p$j"
+done ; done >> $scratch/pigeons.model
+
+# proofs are written next to the model, so everything is run from scratch
+cp models/sudokutemplate.model models/hardsudoku.model $scratch/
+
+# sudoku, with values too big to be held as bits
+sed -e 's/^intvararray g 2 1 9 1 9 1 9$/intvararray g 2 1 9 1 9 101 109/' models/sudokutemplate.model > $scratch/bigsudoku.model
+
+benchmark() {
+    local name=$1
+    shift
+    printf "%-40s %8s\n" "$name" $($solver "$@" | sed -n -e 's/^runtime = //p')
+}
+
+benchmark "pigeons" $scratch/pigeons.model
+benchmark "pigeons --prove" $scratch/pigeons.model --prove
+benchmark "pigeons --prove --proof-comments none" $scratch/pigeons.model --prove --proof-comments none
+benchmark "sudoku enumeration" $scratch/sudokutemplate.model --all-solutions --node-limit 2000
+benchmark "sudoku enumeration --prove" $scratch/sudokutemplate.model --all-solutions --node-limit 2000 --prove
+benchmark "big sudoku enumeration" $scratch/bigsudoku.model --all-solutions --node-limit 2000
+benchmark "big sudoku enumeration --prove" $scratch/bigsudoku.model --all-solutions --node-limit 2000 --prove
+benchmark "hardsudoku" $scratch/hardsudoku.model
+benchmark "hardsudoku --prove" $scratch/hardsudoku.model --prove
@@ -208,5 +208,411 @@ elif ! veripb models/hardsudoku.opb models/hardsudoku.log ; then
 fi
 rm -f models/hardsudoku.opb models/hardsudoku.log
 
+for ordering in min max median random phase ; do
+    if ! grep '^status = true$' <(./certified_constraint_solver models/sudoku.model --value-ordering $ordering ) ; then
+        echo "sudoku $ordering value ordering test failed" 1>&2
+        exit 1
+    fi
+
+    if ! grep '^status = false$' <(./certified_constraint_solver models/hardsudoku.model --prove --value-ordering $ordering ) ; then
+        echo "hardsudoku $ordering value ordering test failed" 1>&2
+        exit 1
+    elif ! veripb models/hardsudoku.opb models/hardsudoku.log ; then
+        echo "hardsudoku $ordering value ordering veripb verification failed" 1>&2
+        exit 1
+    fi
+    rm -f models/hardsudoku.opb models/hardsudoku.log
+done
+
+if ! grep '^x1 = 3$' <(./certified_constraint_solver models/babysat.model --hint models/babysat.hint ) ; then
+    echo "baby sat hint test failed" 1>&2
+    exit 1
+fi
+
+for search in lds dds ; do
+    if ! grep '^status = true$' <(./certified_constraint_solver models/sudoku.model --search $search ) ; then
+        echo "sudoku $search test failed" 1>&2
+        exit 1
+    fi
+
+    if ! grep '^status = false$' <(./certified_constraint_solver models/hardsudoku.model --prove --search $search ) ; then
+        echo "hardsudoku $search test failed" 1>&2
+        exit 1
+    elif ! veripb models/hardsudoku.opb models/hardsudoku.log ; then
+        echo "hardsudoku $search veripb verification failed" 1>&2
+        exit 1
+    fi
+    rm -f models/hardsudoku.opb models/hardsudoku.log
+done
+
+if ! grep '^solutions = 6$' <(./certified_constraint_solver models/babysat.model --count ) ; then
+    echo "baby sat count test failed" 1>&2
+    exit 1
+fi
+
+if [[ 6 != $(./certified_constraint_solver models/babysat.model --all-solutions | grep -c '^solution = ' ) ]] ; then
+    echo "baby sat all solutions test failed" 1>&2
+    exit 1
+fi
+
+if ! grep '^solutions = 16$' <(./certified_constraint_solver models/hall.model --count --prove ) ; then
+    echo "hall count test failed" 1>&2
+    exit 1
+elif ! veripb models/hall.opb models/hall.log ; then
+    echo "hall count veripb verification failed" 1>&2
+    exit 1
+fi
+rm -f models/hall.opb models/hall.log
+
+if ! grep '^objective = 4$' <(./certified_constraint_solver models/minimize.model --prove ) ; then
+    echo "minimize test failed" 1>&2
+    exit 1
+elif ! veripb models/minimize.opb models/minimize.log ; then
+    echo "minimize veripb verification failed" 1>&2
+    exit 1
+fi
+rm -f models/minimize.opb models/minimize.log
+
+if ! grep '^objective = 9$' <(./certified_constraint_solver models/maximize.model --prove ) ; then
+    echo "maximize test failed" 1>&2
+    exit 1
+elif ! veripb models/maximize.opb models/maximize.log ; then
+    echo "maximize veripb verification failed" 1>&2
+    exit 1
+fi
+rm -f models/maximize.opb models/maximize.log
+
+if ! grep '^status = unknown$' <(./certified_constraint_solver models/hardsudoku.model --prove --node-limit 5 ) ; then
+    echo "hardsudoku node limit test failed" 1>&2
+    exit 1
+fi
+rm -f models/hardsudoku.opb models/hardsudoku.log
+
+if ! grep '^aborted = timeout$' <(./certified_constraint_solver models/array.model --count --timeout 1 ) ; then
+    echo "array timeout test failed" 1>&2
+    exit 1
+fi
+
+if ! grep '^status = false$' <(./certified_constraint_solver models/hardsudoku.model --threads 4 ) ; then
+    echo "hardsudoku threads test failed" 1>&2
+    exit 1
+fi
+
+if ! grep '^solutions = 16$' <(./certified_constraint_solver models/hall.model --count --threads 4 ) ; then
+    echo "hall threads count test failed" 1>&2
+    exit 1
+fi
+
+if ! grep '^objective = 4$' <(./certified_constraint_solver models/minimize.model --threads 4 ) ; then
+    echo "minimize threads test failed" 1>&2
+    exit 1
+fi
+
+if ! grep '^solutions = 16$' <(./certified_constraint_solver models/hall.model --count --threads 4 --parallel eps ) ; then
+    echo "hall eps count test failed" 1>&2
+    exit 1
+fi
+
+if ! grep '^objective = 9$' <(./certified_constraint_solver models/maximize.model --threads 4 --parallel eps ) ; then
+    echo "maximize eps test failed" 1>&2
+    exit 1
+fi
+
+if ! diff <(./certified_constraint_solver models/array.model --threads 1 --parallel eps --subproblems-per-thread 120 --value-ordering random | grep '^x\|^status\|^subproblems' ) \
+        <(./certified_constraint_solver models/array.model --threads 4 --parallel eps --subproblems-per-thread 30 --value-ordering random | grep '^x\|^status\|^subproblems' ) ; then
+    echo "array eps reproducibility test failed" 1>&2
+    exit 1
+fi
+
+if ! grep '^subproblems = 199$' <(./certified_constraint_solver models/wide.model --threads 1 --parallel eps --subproblems-per-thread 150 ) ; then
+    echo "wide eps overshoot test failed" 1>&2
+    exit 1
+fi
+
+if ! grep '^status = false$' <(./certified_constraint_solver models/hardsudoku.model --variable-ordering input --prove ) ; then
+    echo "hardsudoku input order test failed" 1>&2
+    exit 1
+elif ! veripb models/hardsudoku.opb models/hardsudoku.log ; then
+    echo "hardsudoku input order veripb verification failed" 1>&2
+    exit 1
+fi
+rm -f models/hardsudoku.opb models/hardsudoku.log
+
+if ! grep '^status = false$' <(./certified_constraint_solver models/hardsudoku.model --parallel portfolio --threads 8 ) ; then
+    echo "hardsudoku portfolio test failed" 1>&2
+    exit 1
+fi
+
+if ! grep '^optimal = true$' <(./certified_constraint_solver models/minimize.model --parallel portfolio --threads 8 ) ; then
+    echo "minimize portfolio test failed" 1>&2
+    exit 1
+elif ! diff <(./certified_constraint_solver models/minimize.model | grep '^objective = ' ) \
+        <(./certified_constraint_solver models/minimize.model --parallel portfolio --threads 8 | grep '^objective = ' ) ; then
+    echo "minimize portfolio objective test failed" 1>&2
+    exit 1
+fi
+
+if ! grep '^cubes = ' <(./certified_constraint_solver models/pigeons.model --prove --write-cubes models/pigeons.cubes --cubes 16 ) ; then
+    echo "pigeons cube generation test failed" 1>&2
+    exit 1
+fi
+for i in $(seq 0 $(( $(wc -l < models/pigeons.cubes) - 1 )) ) ; do
+    if ! grep '^status = false$' <(./certified_constraint_solver models/pigeons.model --prove --cube-file models/pigeons.cubes --solve-cube $i ) ; then
+        echo "pigeons cube $i test failed" 1>&2
+        exit 1
+    fi
+done
+if ! ./certified_constraint_solver models/pigeons.model --cube-file models/pigeons.cubes --combine-cubes ; then
+    echo "pigeons cube combining test failed" 1>&2
+    exit 1
+elif ! veripb models/pigeons.opb models/pigeons.log ; then
+    echo "pigeons cubes veripb verification failed" 1>&2
+    exit 1
+fi
+rm -f models/pigeons.opb models/pigeons.log models/pigeons.cubes models/pigeons.cube*.opb models/pigeons.cube*.log
+
+# alldifferent writes p lines, which refer to earlier derived constraints and
+# so have to be renumbered when they are spliced in
+if ! grep '^cubes = ' <(./certified_constraint_solver models/cliquecubes.model --prove --write-cubes models/cliquecubes.cubes --cubes 4 ) ; then
+    echo "cliquecubes cube generation test failed" 1>&2
+    exit 1
+fi
+for i in $(seq 0 $(( $(wc -l < models/cliquecubes.cubes) - 1 )) ) ; do
+    if ! grep '^status = false$' <(./certified_constraint_solver models/cliquecubes.model --prove --cube-file models/cliquecubes.cubes --solve-cube $i ) ; then
+        echo "cliquecubes cube $i test failed" 1>&2
+        exit 1
+    fi
+done
+cp models/cliquecubes.cube1.log models/cliquecubes.refuted.log
+if ! ./certified_constraint_solver models/cliquecubes.model --prove --cube-file models/cliquecubes.cubes --solve-cube 1 --node-limit 1 ; then
+    echo "cliquecubes aborted cube test failed" 1>&2
+    exit 1
+elif ./certified_constraint_solver models/cliquecubes.model --cube-file models/cliquecubes.cubes --combine-cubes ; then
+    echo "cliquecubes aborted cube combining test failed" 1>&2
+    exit 1
+fi
+mv models/cliquecubes.refuted.log models/cliquecubes.cube1.log
+if ! ./certified_constraint_solver models/cliquecubes.model --cube-file models/cliquecubes.cubes --combine-cubes ; then
+    echo "cliquecubes cube combining test failed" 1>&2
+    exit 1
+elif ! veripb models/cliquecubes.opb models/cliquecubes.log ; then
+    echo "cliquecubes cubes veripb verification failed" 1>&2
+    exit 1
+fi
+rm -f models/cliquecubes.opb models/cliquecubes.log models/cliquecubes.cubes models/cliquecubes.cube*.opb models/cliquecubes.cube*.log
+
+if ! grep '^components = 3$' <(./certified_constraint_solver models/components.model --components --threads 2 ) ; then
+    echo "components test failed" 1>&2
+    exit 1
+elif ! grep '^z = 1$' <(./certified_constraint_solver models/components.model --components --threads 2 ) ; then
+    echo "components solution test failed" 1>&2
+    exit 1
+fi
+
+if ! grep '^status = false$' <(./certified_constraint_solver models/componentsunsat.model --components --threads 2 ) ; then
+    echo "componentsunsat test failed" 1>&2
+    exit 1
+fi
+
+if ! grep '^nodes = 0$' <(./certified_constraint_solver models/hardsudoku.model --prove --probe --threads 4 ) ; then
+    echo "hardsudoku probing test failed" 1>&2
+    exit 1
+elif ! veripb models/hardsudoku.opb models/hardsudoku.log ; then
+    echo "hardsudoku probing veripb verification failed" 1>&2
+    exit 1
+fi
+rm -f models/hardsudoku.opb models/hardsudoku.log
+
+if ! grep '^instance = 2$' <( ( echo models/sudoku.model ; echo --- ; cat models/babysat.model ; echo --- ; echo models/hardsudoku.model ) | ./certified_constraint_solver --batch --threads 2 ) ; then
+    echo "batch test failed" 1>&2
+    exit 1
+elif ! diff <(echo true ; echo true ; echo false) <( ( echo models/sudoku.model ; echo --- ; cat models/babysat.model ; echo --- ; echo models/hardsudoku.model ) | ./certified_constraint_solver --batch --threads 2 | sed -n -e 's/^status = //p' ) ; then
+    echo "batch status test failed" 1>&2
+    exit 1
+elif echo models/sudoku.model | ./certified_constraint_solver --batch --count ; then
+    echo "batch count test failed" 1>&2
+    exit 1
+fi
+
+if ! grep '^status = false$' <(./certified_constraint_solver models/sudokutemplate.model --clues models/hardsudoku.clues ) ; then
+    echo "sudokutemplate clues test failed" 1>&2
+    exit 1
+elif ! diff <(echo true ; echo false) <( ( sed -e 's/^equal \(.*\) \(.*\)$/\1 = \2/' models/hardsudoku.clues | grep -v 'g\[1,1\]' ; echo --- ; cat models/hardsudoku.clues ) | ./certified_constraint_solver --batch --threads 2 models/sudokutemplate.model | sed -n -e 's/^status = //p' ) ; then
+    echo "sudokutemplate batch test failed" 1>&2
+    exit 1
+fi
+
+if ! grep '^status = false$' <(./certified_constraint_solver models/sudokutemplate.model --prove --clues <(echo 'equal g[1,1] 1' ; echo 'equal g[1,1] 2') ) ; then
+    echo "sudokutemplate conflicting clues test failed" 1>&2
+    exit 1
+elif ! diff <(echo false ; echo false) <( ( echo 'g[1,1] = 10' ; echo --- ; echo 'equal g[1,1] 1' ; echo 'equal g[1,1] 2' ) | ./certified_constraint_solver --batch models/sudokutemplate.model | sed -n -e 's/^status = //p' ) ; then
+    echo "sudokutemplate impossible clues batch test failed" 1>&2
+    exit 1
+fi
+rm -f models/sudokutemplate.opb models/sudokutemplate.log
+
+if ! grep -q "line 4, column 12: No variable named 'z'" <(./certified_constraint_solver models/badname.model 2>&1 ) ; then
+    echo "badname error location test failed" 1>&2
+    exit 1
+fi
+
+if ! grep '^compiled_model = models/littlesip.bin$' <(./certified_constraint_solver models/littlesip.model --compile-model models/littlesip.bin ) ; then
+    echo "littlesip compile test failed" 1>&2
+    exit 1
+elif ! grep '^status = false$' <(./certified_constraint_solver models/littlesip.bin --prove ) ; then
+    echo "littlesip compiled model test failed" 1>&2
+    exit 1
+elif ! veripb models/littlesip.opb models/littlesip.log ; then
+    echo "littlesip compiled model veripb verification failed" 1>&2
+    exit 1
+fi
+rm -f models/littlesip.bin models/littlesip.opb models/littlesip.log
+
+./certified_constraint_solver models/reusetable.model --prove > /dev/null
+for m in loadtable loadtablebinary ; do
+    if ! diff <(./certified_constraint_solver models/reusetable.model | grep '^\(status\|x[0-9]\) = ' ) <(./certified_constraint_solver models/$m.model --prove | grep '^\(status\|x[0-9]\) = ' ) ; then
+        echo "$m test failed" 1>&2
+        exit 1
+    elif ! diff models/reusetable.opb models/$m.opb ; then
+        echo "$m opb test failed" 1>&2
+        exit 1
+    fi
+    rm -f models/$m.opb models/$m.log
+done
+rm -f models/reusetable.opb models/reusetable.log
+
+if ! grep '^c\[0,1,1\] = 1$' <(./certified_constraint_solver models/cube.model ) ; then
+    echo "cube test failed" 1>&2
+    exit 1
+elif ! grep '^d\[3\] = 3$' <(./certified_constraint_solver models/cube.model ) ; then
+    echo "cube one dimensional array test failed" 1>&2
+    exit 1
+fi
+
+./certified_constraint_solver models/cube.model --compile-model models/cube.bin > /dev/null
+if ! diff <(./certified_constraint_solver models/cube.model | grep '\] = ' ) <(./certified_constraint_solver models/cube.bin | grep '\] = ' ) ; then
+    echo "cube compiled model test failed" 1>&2
+    exit 1
+fi
+rm -f models/cube.bin
+
+if ! diff <(echo 5 ; echo 5 ; echo 2) <(./certified_constraint_solver models/presolve.model --presolve | sed -n -e 's/^\(constraints_removed\|removed\|variables_eliminated\)_by_presolve = //p' ) ; then
+    echo "presolve test failed" 1>&2
+    exit 1
+elif ! grep '^solutions = 24$' <(./certified_constraint_solver models/presolve.model --presolve --all-solutions ) ; then
+    echo "presolve all solutions test failed" 1>&2
+    exit 1
+fi
+
+if ! grep '^status = false$' <(./certified_constraint_solver models/hardsudoku.model --prove --presolve ) ; then
+    echo "hardsudoku presolve test failed" 1>&2
+    exit 1
+elif ! veripb models/hardsudoku.opb models/hardsudoku.log ; then
+    echo "hardsudoku presolve veripb verification failed" 1>&2
+    exit 1
+fi
+rm -f models/hardsudoku.opb models/hardsudoku.log
+
+# the first propagation has to get its memory from somewhere, but after that
+# it should all be reused
+if ! diff <(./certified_constraint_solver models/sudokutemplate.model --all-solutions --node-limit 100 | grep '^scratch_allocations' ) \
+        <(./certified_constraint_solver models/sudokutemplate.model --all-solutions --node-limit 1000 | grep '^scratch_allocations' ) ; then
+    echo "scratch allocations test failed" 1>&2
+    exit 1
+elif ./certified_constraint_solver models/sudokutemplate.model --node-limit 100 | grep -q '^scratch_allocations = 0$' ; then
+    echo "scratch allocations test failed" 1>&2
+    exit 1
+fi
+
+if ! diff <(./certified_constraint_solver models/hardsudoku.model | grep '^nodes' ) <(./certified_constraint_solver models/hardsudoku.model --prove | grep '^nodes' ) ; then
+    echo "hardsudoku small domain test failed" 1>&2
+    exit 1
+fi
+rm -f models/hardsudoku.opb models/hardsudoku.log
+
+if ! grep '^status = false$' <(./certified_constraint_solver models/pigeons.model --prove --proof-comments none ) ; then
+    echo "pigeons no proof comments test failed" 1>&2
+    exit 1
+elif grep '^\*' models/pigeons.log ; then
+    echo "pigeons no proof comments test wrote comments" 1>&2
+    exit 1
+elif ! veripb models/pigeons.opb models/pigeons.log ; then
+    echo "pigeons no proof comments veripb verification failed" 1>&2
+    exit 1
+fi
+rm -f models/pigeons.opb models/pigeons.log
+
+if ! ./solver_test ; then
+    echo "solver library test failed" 1>&2
+    exit 1
+fi
+
+
+# being told to stop is like hitting a limit, and the proof is still written
+./certified_constraint_solver models/manypigeons.model --prove --proof-comments minimal > models/manypigeons.out &
+sleep 1
+kill -TERM $!
+wait $!
+if ! grep -q '^aborted = interrupted$' models/manypigeons.out ; then
+    echo "interrupt test failed" 1>&2
+    exit 1
+elif [[ "$(tail -n 1 models/manypigeons.log)" != "* search aborted, proof is incomplete" ]] ; then
+    echo "interrupt test did not finish writing the proof" 1>&2
+    exit 1
+fi
+rm -f models/manypigeons.out models/manypigeons.opb models/manypigeons.log
+
+# nobody reading our output shouldn't stop the proof from being finished
+./certified_constraint_solver models/pigeons.model --prove | head -n 1 > /dev/null
+if ! veripb models/pigeons.opb models/pigeons.log ; then
+    echo "closed output veripb verification failed" 1>&2
+    exit 1
+fi
+rm -f models/pigeons.opb models/pigeons.log
+
+if ./certified_constraint_solver models/pigeons.model --prove --write-ref-to /dev/full ; then
+    echo "unwritable proof log test failed" 1>&2
+    exit 1
+fi
+rm -f models/pigeons.opb
+
+
+# a table read from a file can still be added to
+if ! grep -q '^status = true$' <(./certified_constraint_solver models/addtoloadedtable.model ) ; then
+    echo "add to loaded table test failed" 1>&2
+    exit 1
+elif ! grep -q '^status = true$' <(sed -e 's/oneofthree\.tuples/oneofthree.csv/' models/addtoloadedtable.model > models/addtoloadedtable.csv.model ; ./certified_constraint_solver models/addtoloadedtable.csv.model ) ; then
+    echo "add to loaded csv table test failed" 1>&2
+    exit 1
+fi
+rm -f models/addtoloadedtable.csv.model
+
+
+# a model on a pipe has no size to map, so it has to be read instead
+if ! diff <(./certified_constraint_solver models/sudoku.model | grep '^g\[' ) <(./certified_constraint_solver <(cat models/sudoku.model) | grep '^g\[' ) > /dev/null ; then
+    echo "piped model test failed" 1>&2
+    exit 1
+elif ! grep -q '^status = true$' <(./certified_constraint_solver <(cat models/sudoku.model) ) ; then
+    echo "piped model status test failed" 1>&2
+    exit 1
+fi
+
+
+# solves running at the same time each count only their own allocations, so
+# each instance either warms up a new thread, or reuses one that already has
+if ! diff <(echo 0 ; ./certified_constraint_solver models/hardsudoku.model | sed -n -e 's/^scratch_allocations = //p' ) \
+        <( ( for i in 1 2 3 4 5 6 7 ; do cat models/hardsudoku.clues ; echo --- ; done ; cat models/hardsudoku.clues ) | \
+            ./certified_constraint_solver --batch --threads 4 models/sudokutemplate.model | sed -n -e 's/^scratch_allocations = //p' | sort -n -u ) ; then
+    echo "concurrent scratch allocations test failed" 1>&2
+    exit 1
+fi
+
+
+# a template which fails when propagated still reads each set of clues
+if ! diff <(echo false ; echo error) <( ( echo 'y2 = 2' ; echo --- ; echo 'y9 = 1' ) | ./certified_constraint_solver --batch models/nosearchunsat.model | sed -n -e 's/^status = //p' ) ; then
+    echo "failed template batch test failed" 1>&2
+    exit 1
+fi
+
 true
 
@@ -1,23 +1,27 @@
 /* vim: set sw=4 sts=4 et foldmethod=syntax : */
 
 #include "all_different_constraint.hh"
+#include "binary_model.hh"
 #include "model.hh"
 #include "proof.hh"
+#include "scratch.hh"
 #include "variable.hh"
 
 #include <algorithm>
-#include <functional>
+#include <array>
+#include <cstdint>
 #include <iomanip>
 #include <list>
+#include <memory_resource>
 #include <ostream>
 #include <set>
 #include <type_traits>
 #include <utility>
 #include <variant>
 
+using std::array;
 using std::decay_t;
 using std::endl;
-using std::function;
 using std::is_same_v;
 using std::list;
 using std::map;
@@ -29,28 +33,36 @@ using std::pair;
 using std::set;
 using std::string;
 using std::tuple;
+using std::uint64_t;
 using std::variant;
 using std::vector;
 using std::visit;
 
+namespace pmr = std::pmr;
+
 using Vertex = variant<VariableID, VariableValue>;
 
 AllDifferentConstraint::AllDifferentConstraint(vector<VariableID> && v, AllDifferentStrength s) :
     _vars(move(v)),
-    _strength(s)
+    _strength(s),
+    _has_duplicate_variables(set<VariableID>{ _vars.begin(), _vars.end() }.size() != _vars.size())
 {
 }
 
 AllDifferentConstraint::~AllDifferentConstraint() = default;
 
+namespace
+{
 auto build_matching(
-        const set<pair<VariableID, VariableValue> > & edges,
-        const set<VariableID> & lhs,
-        set<VariableID> & left_covered,
-        set<VariableValue> & right_covered,
-        set<pair<VariableID, VariableValue> > & matching
+        const pmr::set<pair<VariableID, VariableValue> > & edges,
+        const pmr::set<VariableID> & lhs,
+        pmr::set<VariableID> & left_covered,
+        pmr::set<VariableValue> & right_covered,
+        pmr::set<pair<VariableID, VariableValue> > & matching
         ) -> void
 {
+    auto scratch = matching.get_allocator().resource();
+
     // start with a greedy matching
     for (auto & e : edges) {
         if ((! left_covered.count(e.first)) && (! right_covered.count(e.second))) {
@@ -62,11 +74,11 @@ auto build_matching(
 
     // now augment
     while (true) {
-        set<VariableID> reached_on_the_left;
-        set<VariableValue> reached_on_the_right;
+        pmr::set<VariableID> reached_on_the_left{ scratch };
+        pmr::set<VariableValue> reached_on_the_right{ scratch };
 
-        map<VariableValue, VariableID> how_we_got_to_on_the_right;
-        map<VariableID, VariableValue> how_we_got_to_on_the_left;
+        pmr::map<VariableValue, VariableID> how_we_got_to_on_the_right{ scratch };
+        pmr::map<VariableID, VariableValue> how_we_got_to_on_the_left{ scratch };
 
         // start from exposed variables
         set_difference(lhs.begin(), lhs.end(), left_covered.begin(), left_covered.end(),
@@ -146,27 +158,32 @@ auto build_matching(
             break;
     }
 }
+}
 
 auto AllDifferentConstraint::_prove_matching_is_too_small(
         Model & model,
         Proof & proof,
-        const set<pair<VariableID, VariableValue> > & edges,
-        const set<VariableID> & lhs,
-        const set<VariableID> & left_covered,
-        const set<pair<VariableID, VariableValue> > & matching
+        const pmr::set<pair<VariableID, VariableValue> > & edges,
+        const pmr::set<VariableID> & lhs,
+        const pmr::set<VariableID> & left_covered,
+        const pmr::set<pair<VariableID, VariableValue> > & matching
         ) const -> void
 {
-    map<VariableValue, VariableID> inverse_matching;
+    auto scratch = matching.get_allocator().resource();
+
+    pmr::map<VariableValue, VariableID> inverse_matching{ scratch };
     for (auto & [ l, r ] : matching)
         inverse_matching.emplace(r, l);
 
-    proof.proof_stream() << "* matching is";
-    for (auto & [ l, r ] : matching)
-        proof.proof_stream() << " (" << model.original_name(l) << ", " << int{ r } << ")";
-    proof.proof_stream() << endl;
+    if (proof.comments(ProofComments::Full)) {
+        proof.proof_stream() << "* matching is";
+        for (auto & [ l, r ] : matching)
+            proof.proof_stream() << " (" << model.original_name(l) << ", " << int{ r } << ")";
+        proof.proof_stream() << endl;
+    }
 
-    set<VariableID> hall_variables;
-    set<VariableValue> hall_values;
+    pmr::set<VariableID> hall_variables{ scratch };
+    pmr::set<VariableValue> hall_values{ scratch };
 
     // there must be at least one thing uncovered, and this will
     // necessarily participate in a hall violator
@@ -179,7 +196,7 @@ auto AllDifferentConstraint::_prove_matching_is_too_small(
     // either we have found a hall violator, or we have a spare value
     // on the right
     while (true) {
-        set<VariableValue> n_of_hall_variables;
+        pmr::set<VariableValue> n_of_hall_variables{ scratch };
         for (auto & [ l, r ] : edges)
             if (hall_variables.count(l))
                 n_of_hall_variables.insert(r);
@@ -204,7 +221,8 @@ auto AllDifferentConstraint::_prove_matching_is_too_small(
         hall_values.insert(not_subset_witness);
     }
 
-    proof.proof_stream() << "* found a hall violator" << endl;
+    if (proof.comments(ProofComments::Full))
+        proof.proof_stream() << "* found a hall violator" << endl;
 
     // each variable in the violator has to take at least one value that is
     // left in its domain...
@@ -220,23 +238,27 @@ auto AllDifferentConstraint::_prove_matching_is_too_small(
     proof.next_proof_line();
 }
 
+namespace
+{
 auto _prove_deletion_using_sccs(
         const std::map<VariableValue, int> & _constraint_numbers,
         Model & model,
         Proof & proof,
-        const map<VariableID, list<VariableValue> > & edges_out_from_variable,
-        const map<VariableValue, list<VariableID> > & edges_out_from_value,
+        const pmr::map<VariableID, pmr::list<VariableValue> > & edges_out_from_variable,
+        const pmr::map<VariableValue, pmr::list<VariableID> > & edges_out_from_value,
         const VariableID delete_variable,
         const VariableValue delete_value,
-        const map<Vertex, int> & components
+        const pmr::map<Vertex, int> & components
         ) -> void
 {
+    auto scratch = components.get_allocator().resource();
+
     // we know a hall set exists, but we have to find it. starting
     // from but not including the end of the edge we're deleting,
     // everything reachable forms a hall set.
-    set<Vertex> to_explore, explored;
-    set<VariableID> hall_left;
-    set<VariableValue> hall_right;
+    pmr::set<Vertex> to_explore{ scratch }, explored{ scratch };
+    pmr::set<VariableID> hall_left{ scratch };
+    pmr::set<VariableValue> hall_right{ scratch };
     to_explore.insert(delete_value);
     int care_about_scc = components.find(delete_value)->second;
     while (! to_explore.empty()) {
@@ -266,14 +288,16 @@ auto _prove_deletion_using_sccs(
         }, n);
     }
 
-    proof.proof_stream() << "* all different, found hall set {";
-    for (auto & h : hall_left)
-        proof.proof_stream() << " " << model.original_name(h);
+    if (proof.comments(ProofComments::Full)) {
+        proof.proof_stream() << "* all different, found hall set {";
+        for (auto & h : hall_left)
+            proof.proof_stream() << " " << model.original_name(h);
 
-    proof.proof_stream() << " } having values {";
-    for (auto & w : hall_right)
-        proof.proof_stream() << " " << int{ w };
-    proof.proof_stream() << " } and so " << model.original_name(delete_variable) << " != " << int{ delete_value } << endl;
+        proof.proof_stream() << " } having values {";
+        for (auto & w : hall_right)
+            proof.proof_stream() << " " << int{ w };
+        proof.proof_stream() << " } and so " << model.original_name(delete_variable) << " != " << int{ delete_value } << endl;
+    }
 
     proof.proof_stream() << "p 0";
     for (auto & h : hall_left)
@@ -284,13 +308,123 @@ auto _prove_deletion_using_sccs(
 
     proof.next_proof_line();
 }
+}
 
-auto AllDifferentConstraint::propagate(Model & model, optional<Proof> & proof, set<VariableID> & changed_vars) const -> bool
+auto AllDifferentConstraint::_propagate_small(Model & model, AllDifferentStrength strength, pmr::set<VariableID> & changed_vars) const -> bool
 {
+    constexpr int limit = Domain::small_limit;
+
+    // more variables than values can never work
+    if (_vars.size() > unsigned(limit))
+        return false;
+
+    int n = _vars.size();
+    array<uint64_t, limit> domains;
+    for (int x = 0 ; x < n ; ++x)
+        domains[x] = model.get_variable(_vars[x])->values.bits();
+
+    // find a matching using augmenting paths, where each search step looks at
+    // every value a variable could take at once
+    array<int, limit> value_of_variable, variable_of_value;
+    uint64_t matched_values = 0;
+
+    auto augment = [&] (const auto & augment, int x, uint64_t & visited) -> bool {
+        auto candidates = domains[x] & ~visited;
+        if (auto free = candidates & ~matched_values) {
+            int a = __builtin_ctzll(free);
+            value_of_variable[x] = a;
+            variable_of_value[a] = x;
+            matched_values |= uint64_t{ 1 } << a;
+            return true;
+        }
+
+        while ((candidates &= ~visited)) {
+            int a = __builtin_ctzll(candidates);
+            visited |= uint64_t{ 1 } << a;
+            if (augment(augment, variable_of_value[a], visited)) {
+                value_of_variable[x] = a;
+                variable_of_value[a] = x;
+                return true;
+            }
+        }
+
+        return false;
+    };
+
+    for (int x = 0 ; x < n ; ++x) {
+        uint64_t visited = 0;
+        if (! augment(augment, x, visited))
+            return false;
+    }
+
+    if (strength != AllDifferentStrength::GAC)
+        return true;
+
+    // if x takes a rather than its matched value b, then whoever was matched
+    // to a has to move, and so on, until we reach a value nobody is using,
+    // or until someone moves to b. so from each matched value, we can get to
+    // every other value its variable could take.
+    uint64_t all_values = 0;
+    for (int x = 0 ; x < n ; ++x)
+        all_values |= domains[x];
+
+    array<uint64_t, limit> reach;
+    for (auto m = matched_values ; m ; m &= m - 1) {
+        int a = __builtin_ctzll(m);
+        reach[a] = domains[variable_of_value[a]] & ~(uint64_t{ 1 } << a);
+    }
+
+    // which values can get to one that nobody is using?
+    uint64_t reaches_free = all_values & ~matched_values;
+    for (bool changed = true ; changed ; ) {
+        changed = false;
+        for (auto m = matched_values & ~reaches_free ; m ; m &= m - 1) {
+            int a = __builtin_ctzll(m);
+            if (reach[a] & reaches_free) {
+                reaches_free |= uint64_t{ 1 } << a;
+                changed = true;
+            }
+        }
+    }
+
+    // and what can get to what, by taking the transitive closure
+    for (auto k = matched_values ; k ; k &= k - 1) {
+        int kv = __builtin_ctzll(k);
+        for (auto m = matched_values ; m ; m &= m - 1) {
+            int a = __builtin_ctzll(m);
+            if (reach[a] & (uint64_t{ 1 } << kv))
+                reach[a] |= reach[kv];
+        }
+    }
+
+    for (int x = 0 ; x < n ; ++x) {
+        int b = value_of_variable[x];
+        // anything unused is in reaches_free, so everything here is matched
+        auto unsupported = domains[x] & ~(uint64_t{ 1 } << b) & ~reaches_free;
+        for (auto m = unsupported ; m ; m &= m - 1) {
+            int a = __builtin_ctzll(m);
+            if (! (reach[a] & (uint64_t{ 1 } << b))) {
+                model.get_variable(_vars[x])->values.erase(VariableValue{ a });
+                changed_vars.emplace(_vars[x]);
+            }
+        }
+    }
+
+    return true;
+}
+
+template <bool Proving_>
+auto AllDifferentConstraint::_propagate_graph(Model & model, optional<Proof> & proof, AllDifferentStrength strength,
+        pmr::set<VariableID> & changed_vars) const -> bool
+{
+    // all of our working memory goes away in one go when we return
+    ScratchScope scope;
+    auto scratch = scope.resource();
+
     // find a matching to check feasibility
-    set<VariableID> lhs{ _vars.begin(), _vars.end() };
-    set<VariableValue> rhs;
-    set<pair<VariableID, VariableValue> > edges;
+    pmr::set<VariableID> lhs{ _vars.begin(), _vars.end(), scratch };
+    pmr::set<VariableValue> rhs{ scratch };
+    pmr::set<pair<VariableID, VariableValue> > edges{ scratch };
 
     for (auto & v : _vars) {
         auto & values = model.get_variable(v)->values;
@@ -300,9 +434,9 @@ auto AllDifferentConstraint::propagate(Model & model, optional<Proof> & proof, s
         }
     }
 
-    set<VariableID> left_covered;
-    set<VariableValue> right_covered;
-    set<pair<VariableID, VariableValue> > matching;
+    pmr::set<VariableID> left_covered{ scratch };
+    pmr::set<VariableValue> right_covered{ scratch };
+    pmr::set<pair<VariableID, VariableValue> > matching{ scratch };
 
     build_matching(edges, lhs, left_covered, right_covered, matching);
 
@@ -311,39 +445,41 @@ auto AllDifferentConstraint::propagate(Model & model, optional<Proof> & proof, s
         // nope. we've got a maximum cardinality matching that leaves at least
         // one thing on the left uncovered. possibly output a proof, then
         // return indicating a contradiction.
-        if (proof)
+        if constexpr (Proving_)
             _prove_matching_is_too_small(model, *proof, edges, lhs, left_covered, matching);
 
         return false;
     }
 
-    if (_strength != AllDifferentStrength::GAC)
+    if (strength != AllDifferentStrength::GAC)
         return true;
 
     // we have a matching that uses every variable. however, some edges may
     // not occur in any maximum cardinality matching, and we can delete
     // these. first we need to build the directed matching graph...
-    map<Vertex, list<Vertex> > edges_out_from;
-    map<VariableID, list<VariableValue> > edges_out_from_variable, edges_in_to_variable;
-    map<VariableValue, list<VariableID> > edges_out_from_value, edges_in_to_value;
+    pmr::map<Vertex, pmr::list<Vertex> > edges_out_from{ scratch };
+    pmr::map<VariableID, pmr::list<VariableValue> > edges_out_from_variable{ scratch }, edges_in_to_variable{ scratch };
+    pmr::map<VariableValue, pmr::list<VariableID> > edges_out_from_value{ scratch }, edges_in_to_value{ scratch };
 
     for (auto & [ f, t ] : edges)
         if (matching.count(pair{ f, t })) {
             edges_out_from[t].push_back(f);
-            edges_out_from_value[t].push_back(f);
+            if constexpr (Proving_)
+                edges_out_from_value[t].push_back(f);
             edges_in_to_variable[f].push_back(t);
         }
         else {
             edges_out_from[f].push_back(t);
-            edges_out_from_variable[f].push_back(t);
+            if constexpr (Proving_)
+                edges_out_from_variable[f].push_back(t);
             edges_in_to_value[t].push_back(f);
         }
 
     // now we need to find strongly connected components...
-    map<Vertex, int> indices, lowlinks, components;
-    list<Vertex> stack;
-    set<Vertex> enstackinated;
-    set<Vertex> all_vertices;
+    pmr::map<Vertex, int> indices{ scratch }, lowlinks{ scratch }, components{ scratch };
+    pmr::list<Vertex> stack{ scratch };
+    pmr::set<Vertex> enstackinated{ scratch };
+    pmr::set<Vertex> all_vertices{ scratch };
     int next_index = 0, number_of_components = 0;
 
     for (auto & v : _vars) {
@@ -352,8 +488,9 @@ auto AllDifferentConstraint::propagate(Model & model, optional<Proof> & proof, s
             all_vertices.emplace(w);
     }
 
-    function<auto (Vertex) -> void> scc;
-    scc = [&] (Vertex v) -> void {
+    // a std::function would allocate, so the lambda is passed itself to
+    // recurse
+    auto scc = [&] (const auto & scc, Vertex v) -> void {
         indices.emplace(v, next_index);
         lowlinks.emplace(v, next_index);
         ++next_index;
@@ -362,7 +499,7 @@ auto AllDifferentConstraint::propagate(Model & model, optional<Proof> & proof, s
 
         for (auto & w : edges_out_from[v]) {
             if (! indices.count(w)) {
-                scc(w);
+                scc(scc, w);
                 lowlinks[v] = min(lowlinks[v], lowlinks[w]);
             }
             else if (enstackinated.count(w)) {
@@ -384,16 +521,16 @@ auto AllDifferentConstraint::propagate(Model & model, optional<Proof> & proof, s
 
     for (auto & v : all_vertices)
         if (! indices.count(v))
-            scc(v);
+            scc(scc, v);
 
     // every edge in the original matching is used, and so cannot be
     // deleted
-    auto used_edges = matching;
+    pmr::set<pair<VariableID, VariableValue> > used_edges{ matching, scratch };
 
     // for each unmatched vertex, bring in everything that could be updated
     // to take it
     {
-        set<Vertex> to_explore{ rhs.begin(), rhs.end() }, explored;
+        pmr::set<Vertex> to_explore{ rhs.begin(), rhs.end(), scratch }, explored{ scratch };
         for (auto & [ _, t ] : matching)
             to_explore.erase(t);
 
@@ -427,7 +564,7 @@ auto AllDifferentConstraint::propagate(Model & model, optional<Proof> & proof, s
             used_edges.emplace(f, t);
 
     // avoid outputting duplicate proof lines
-    set<int> sccs_already_done;
+    pmr::set<int> sccs_already_done{ scratch };
 
     // anything left can be deleted
     for (auto & [ delete_var_name, delete_value ] : edges) {
@@ -436,11 +573,11 @@ auto AllDifferentConstraint::propagate(Model & model, optional<Proof> & proof, s
 
         auto delete_var = model.get_variable(delete_var_name);
         if (delete_var->values.count(delete_value)) {
-            if (proof) {
+            if constexpr (Proving_) {
                 if (sccs_already_done.emplace(components.find(delete_value)->second).second)
                     _prove_deletion_using_sccs(_constraint_numbers, model, *proof, edges_out_from_variable,
                             edges_out_from_value, delete_var_name, delete_value, components);
-                else
+                else if (proof->comments(ProofComments::Full))
                     proof->proof_stream() << "* can reuse hall set to show " << model.original_name(delete_var_name)
                         << " != " << int{ delete_value } << endl;
             }
@@ -453,6 +590,30 @@ auto AllDifferentConstraint::propagate(Model & model, optional<Proof> & proof, s
     return true;
 }
 
+auto AllDifferentConstraint::propagate(Model & model, optional<Proof> & proof, pmr::set<VariableID> & changed_vars) const -> bool
+{
+    auto strength = model.all_different_strength_override().value_or(_strength);
+
+    // without a proof to write, small domains can be handled using bits,
+    // rather than building the graph explicitly
+    if (! proof && ! _has_duplicate_variables) {
+        bool all_small = true;
+        for (auto & v : _vars)
+            if (! model.get_variable(v)->values.small()) {
+                all_small = false;
+                break;
+            }
+
+        if (all_small)
+            return _propagate_small(model, strength, changed_vars);
+    }
+
+    if (proof)
+        return _propagate_graph<true>(model, proof, strength, changed_vars);
+    else
+        return _propagate_graph<false>(model, proof, strength, changed_vars);
+}
+
 auto AllDifferentConstraint::start_proof(const Model & model, Proof & proof) -> void
 {
     proof.model_stream() << "* all different" << endl;
@@ -487,3 +648,25 @@ auto AllDifferentConstraint::priority() const -> int
     return 2;
 }
 
+auto AllDifferentConstraint::write_binary(BinaryModelWriter & writer) const -> void
+{
+    writer.start_constraint(BinaryConstraintKind::AllDifferent);
+    writer.write_int(static_cast<int>(_strength));
+    writer.write_variables(_vars);
+}
+
+auto AllDifferentConstraint::entailed(const Model & model) const -> bool
+{
+    // if no value appears in two domains, nothing can clash
+    set<VariableValue> seen;
+    for (auto & v : _vars)
+        for (auto & value : model.get_variable(v)->values)
+            if (! seen.insert(value).second)
+                return false;
+    return true;
+}
+
+auto AllDifferentConstraint::all_different_strength(const Model & model) const -> optional<AllDifferentStrength>
+{
+    return model.all_different_strength_override().value_or(_strength);
+}
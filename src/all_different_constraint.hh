@@ -7,6 +7,7 @@
 
 #include <list>
 #include <map>
+#include <memory_resource>
 #include <set>
 #include <string>
 #include <tuple>
@@ -18,18 +19,28 @@ enum class AllDifferentStrength
     GAC
 };
 
-class AllDifferentConstraint : public Constraint
+class AllDifferentConstraint final : public Constraint
 {
     private:
         std::vector<VariableID> _vars;
         std::map<VariableValue, int> _constraint_numbers;
         AllDifferentStrength _strength;
+        bool _has_duplicate_variables;
+
+        // propagation using bit operations, for when every domain is small
+        // and we aren't writing a proof
+        auto _propagate_small(Model &, AllDifferentStrength, std::pmr::set<VariableID> &) const -> bool;
+
+        // propagation by building the matching graph, with proof logging
+        // compiled in or out
+        template <bool Proving_>
+        auto _propagate_graph(Model &, std::optional<Proof> &, AllDifferentStrength, std::pmr::set<VariableID> &) const -> bool;
 
         auto _prove_deletion_using_hall_set(
                 Model &,
                 Proof &,
-                const std::map<VariableID, std::list<VariableValue> > & edges_out_from_variable,
-                const std::map<VariableValue, std::list<VariableID> > & edges_out_from_value,
+                const std::pmr::map<VariableID, std::pmr::list<VariableValue> > & edges_out_from_variable,
+                const std::pmr::map<VariableValue, std::pmr::list<VariableID> > & edges_out_from_value,
                 const VariableID delete_variable,
                 const VariableValue delete_value
                 ) const -> void;
@@ -37,23 +48,29 @@ class AllDifferentConstraint : public Constraint
         auto _prove_matching_is_too_small(
                 Model &,
                 Proof &,
-                const std::set<std::pair<VariableID, VariableValue> > & edges,
-                const std::set<VariableID> & lhs,
-                const std::set<VariableID> & left_covered,
-                const std::set<std::pair<VariableID, VariableValue> > & matching
+                const std::pmr::set<std::pair<VariableID, VariableValue> > & edges,
+                const std::pmr::set<VariableID> & lhs,
+                const std::pmr::set<VariableID> & left_covered,
+                const std::pmr::set<std::pair<VariableID, VariableValue> > & matching
                 ) const -> void;
 
     public:
         AllDifferentConstraint(std::vector<VariableID> &&, AllDifferentStrength);
         virtual ~AllDifferentConstraint() override;
 
-        virtual auto propagate(Model & model, std::optional<Proof> &, std::set<VariableID> &) const -> bool override;
+        virtual auto propagate(Model & model, std::optional<Proof> &, std::pmr::set<VariableID> &) const -> bool override;
 
         virtual auto start_proof(const Model &, Proof &) -> void override;
 
         virtual auto associated_variables() const -> std::set<VariableID> override;
 
         virtual auto priority() const -> int override;
+
+        virtual auto write_binary(BinaryModelWriter &) const -> void override;
+
+        virtual auto entailed(const Model &) const -> bool override;
+
+        virtual auto all_different_strength(const Model &) const -> std::optional<AllDifferentStrength> override;
 };
 
 #endif
@@ -0,0 +1,207 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+#include "batch.hh"
+#include "model.hh"
+#include "proof.hh"
+#include "read_model.hh"
+#include "result.hh"
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using std::condition_variable;
+using std::deque;
+using std::endl;
+using std::exception;
+using std::getline;
+using std::ifstream;
+using std::istream;
+using std::map;
+using std::move;
+using std::mutex;
+using std::optional;
+using std::ostream;
+using std::pair;
+using std::string;
+using std::stringstream;
+using std::thread;
+using std::unique_lock;
+using std::vector;
+
+using std::chrono::duration_cast;
+using std::chrono::milliseconds;
+using std::chrono::steady_clock;
+
+namespace
+{
+struct BatchQueue
+{
+    mutex queue_mutex;
+    condition_variable queue_changed;
+    deque<pair<unsigned long long, string> > waiting;
+    bool finished_reading = false;
+
+    // results that have finished, but which can't be written until everything
+    // before them has been
+    mutex output_mutex;
+    map<unsigned long long, string> finished;
+    unsigned long long next_to_write = 0;
+};
+
+auto trim_line(const string & line) -> string
+{
+    auto end = line.find_last_not_of(" \t\r");
+    auto start = line.find_first_not_of(" \t\r");
+    return string::npos == end ? string{ } : line.substr(start, end - start + 1);
+}
+
+// root is the template after propagation, or null if propagating it failed
+auto solve_instance(unsigned long long index, const string & text, const SolveOptions & options, const string & delimiter,
+        const optional<Model> & model_template, const Model * root) -> string
+{
+    stringstream record;
+    record << "instance = " << index << '\n';
+
+    auto start_time = steady_clock::now();
+    try {
+        auto instance_options = options;
+        optional<Model> model;
+        if (model_template) {
+            // the clues are checked against the template as it was written,
+            // so that they are read the same way as with --clues
+            stringstream clues{ text };
+            instance_options.assumptions = read_clues(clues, *model_template);
+        }
+        else {
+            // a single line naming a file means read that file
+            string first_line;
+            stringstream lines{ text };
+            while (getline(lines, first_line) && trim_line(first_line).empty())
+                ;
+            string rest, other;
+            while (getline(lines, other))
+                rest += trim_line(other);
+
+            if (rest.empty() && ifstream{ trim_line(first_line) }) {
+                record << "model_file = " << trim_line(first_line) << '\n';
+                model.emplace(read_model(trim_line(first_line)));
+            }
+            else {
+                stringstream inline_model{ text };
+                model.emplace(read_model(inline_model));
+            }
+        }
+
+        // every instance starts from a copy of the propagated template. if
+        // propagating the template failed, then no instance has a solution
+        optional<Proof> no_proof;
+        Result result;
+        if (! model_template)
+            result = solve(*model, no_proof, instance_options);
+        else if (root)
+            result = solve(*root, no_proof, instance_options);
+        write_result(record, result, options, duration_cast<milliseconds>(steady_clock::now() - start_time));
+    }
+    catch (const exception & e) {
+        record << "status = error" << '\n';
+        record << "error = " << e.what() << '\n';
+    }
+
+    record << delimiter << '\n';
+    return record.str();
+}
+
+auto run_batch_worker(BatchQueue & queue, ostream & output, const SolveOptions & options, const string & delimiter,
+        const optional<Model> & model_template, const Model * root) -> void
+{
+    while (true) {
+        pair<unsigned long long, string> instance;
+        {
+            unique_lock<mutex> guard{ queue.queue_mutex };
+            queue.queue_changed.wait(guard, [&] { return queue.finished_reading || ! queue.waiting.empty(); });
+            if (queue.waiting.empty())
+                return;
+            instance = move(queue.waiting.front());
+            queue.waiting.pop_front();
+        }
+
+        auto record = solve_instance(instance.first, instance.second, options, delimiter, model_template, root);
+
+        unique_lock<mutex> guard{ queue.output_mutex };
+        queue.finished.emplace(instance.first, move(record));
+        while ((! queue.finished.empty()) && queue.finished.begin()->first == queue.next_to_write) {
+            output << queue.finished.begin()->second << std::flush;
+            queue.finished.erase(queue.finished.begin());
+            ++queue.next_to_write;
+        }
+    }
+}
+}
+
+auto run_batch(istream & input, ostream & output, const SolveOptions & options,
+        unsigned threads, const string & delimiter, const optional<Model> & model_template) -> unsigned long long
+{
+    BatchQueue queue;
+
+    // each instance gets a single thread, and the pool provides the parallelism
+    auto instance_options = options;
+    instance_options.threads = 1;
+
+    // propagate the template once, as Solver does, rather than having every
+    // instance work out the same thing again
+    optional<Model> propagated_template;
+    if (model_template) {
+        optional<Proof> no_proof;
+        propagated_template.emplace(*model_template);
+        if (! propagated_template->propagate(no_proof))
+            propagated_template.reset();
+    }
+    const Model * root = propagated_template ? &*propagated_template : nullptr;
+
+    vector<thread> workers;
+    for (unsigned t = 0 ; t < (threads == 0 ? 1 : threads) ; ++t)
+        workers.emplace_back([&] () { run_batch_worker(queue, output, instance_options, delimiter, model_template, root); });
+
+    // read as we go, so that we can be fed from a pipe by something that is
+    // waiting for answers
+    unsigned long long instances = 0;
+    string line, text;
+    auto enqueue = [&] () {
+        if (! trim_line(text).empty()) {
+            unique_lock<mutex> guard{ queue.queue_mutex };
+            queue.waiting.emplace_back(instances++, move(text));
+            queue.queue_changed.notify_one();
+        }
+        text.clear();
+    };
+
+    while (getline(input, line)) {
+        if (trim_line(line) == delimiter)
+            enqueue();
+        else
+            text += line + '\n';
+    }
+    enqueue();
+
+    {
+        unique_lock<mutex> guard{ queue.queue_mutex };
+        queue.finished_reading = true;
+        queue.queue_changed.notify_all();
+    }
+
+    for (auto & w : workers)
+        w.join();
+
+    return instances;
+}
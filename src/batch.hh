@@ -0,0 +1,28 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+#ifndef CERTIFIED_CONSTRAINT_SOLVER_GUARD_SRC_BATCH_HH
+#define CERTIFIED_CONSTRAINT_SOLVER_GUARD_SRC_BATCH_HH 1
+
+#include "solve.hh"
+
+#include <iosfwd>
+#include <optional>
+#include <string>
+
+/**
+ * Solve a stream of instances, separated by delimiter lines. An instance that
+ * is a single line naming a file is read from that file, and anything else is
+ * treated as a model in its own right. Instances are solved using a pool of
+ * threads, each running a single-threaded search, and the results are written
+ * out in input order, each tagged with its instance number and followed by a
+ * delimiter line. Returns how many instances there were.
+ *
+ * If a model template is given, each instance is instead a set of clues, in
+ * the format accepted by read_clues(), which are applied to the template as
+ * restrictions at the root. The template is only read and propagated once,
+ * and each instance starts from a copy of the propagated template.
+ */
+auto run_batch(std::istream & input, std::ostream & output, const SolveOptions & options,
+        unsigned threads, const std::string & delimiter, const std::optional<Model> & model_template) -> unsigned long long;
+
+#endif
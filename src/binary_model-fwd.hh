@@ -0,0 +1,8 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+#ifndef CERTIFIED_CONSTRAINT_SOLVER_GUARD_SRC_BINARY_MODEL_FWD_HH
+#define CERTIFIED_CONSTRAINT_SOLVER_GUARD_SRC_BINARY_MODEL_FWD_HH 1
+
+class BinaryModelWriter;
+
+#endif
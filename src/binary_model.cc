@@ -0,0 +1,361 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+#include "binary_model.hh"
+#include "all_different_constraint.hh"
+#include "constraint.hh"
+#include "equals_constant_constraint.hh"
+#include "mapped_file.hh"
+#include "model.hh"
+#include "not_equals_constraint.hh"
+#include "read_model.hh"
+#include "table_constraint.hh"
+#include "variable.hh"
+
+#include <cstring>
+#include <ios>
+#include <iterator>
+#include <fstream>
+#include <map>
+#include <set>
+#include <utility>
+
+using std::int32_t;
+using std::ios;
+using std::make_shared;
+using std::make_unique;
+using std::map;
+using std::memcpy;
+using std::move;
+using std::pair;
+using std::prev;
+using std::ofstream;
+using std::set;
+using std::shared_ptr;
+using std::size_t;
+using std::string;
+using std::string_view;
+using std::to_string;
+using std::uint32_t;
+using std::uint64_t;
+using std::uintptr_t;
+using std::vector;
+
+// the version must change whenever the layout does. everything is written
+// in native byte order, in four or eight byte fields, so that the values in
+// each table are aligned and can be used directly from a mapping.
+const string binary_model_magic = "CCSMODEL";
+const uint32_t binary_model_version = 2;
+const uint32_t binary_model_byte_order = 0x01020304;
+
+namespace
+{
+template <typename T_>
+auto append_binary(string & out, const T_ & value) -> void
+{
+    out.append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+// names are padded, to keep everything after them aligned
+auto append_name(string & out, const string & name) -> void
+{
+    append_binary(out, uint32_t(name.size()));
+    out.append(name);
+    out.append((4 - name.size() % 4) % 4, '\0');
+}
+
+auto append_domain(string & out, const set<VariableValue> & values) -> void
+{
+    append_binary(out, uint64_t{ values.size() });
+    for (auto & val : values)
+        append_binary(out, int32_t{ int{ val } });
+}
+}
+
+struct BinaryModelWriter::Imp
+{
+    string tables;
+    string constraints;
+    uint64_t number_of_tables = 0;
+    uint64_t number_of_constraints = 0;
+    map<const Table *, uint64_t> table_indices;
+};
+
+BinaryModelWriter::BinaryModelWriter() :
+    _imp(make_unique<Imp>())
+{
+}
+
+BinaryModelWriter::~BinaryModelWriter() = default;
+
+auto BinaryModelWriter::start_constraint(BinaryConstraintKind kind) -> void
+{
+    ++_imp->number_of_constraints;
+    append_binary(_imp->constraints, static_cast<uint32_t>(kind));
+}
+
+auto BinaryModelWriter::write_int(int value) -> void
+{
+    append_binary(_imp->constraints, int32_t{ value });
+}
+
+auto BinaryModelWriter::write_variables(const vector<VariableID> & vars) -> void
+{
+    append_binary(_imp->constraints, uint64_t{ vars.size() });
+    for (auto & v : vars)
+        append_binary(_imp->constraints, int32_t{ int{ v } });
+}
+
+auto BinaryModelWriter::write_table(const shared_ptr<const Table> & table) -> void
+{
+    auto [ index, inserted ] = _imp->table_indices.emplace(table.get(), _imp->number_of_tables);
+    if (inserted) {
+        ++_imp->number_of_tables;
+        append_binary(_imp->tables, int32_t{ table->arity() });
+        append_binary(_imp->tables, uint64_t{ table->number_of_tuples() });
+        _imp->tables.append(reinterpret_cast<const char *>(table->values()),
+                table->number_of_tuples() * table->arity() * sizeof(int32_t));
+    }
+
+    append_binary(_imp->constraints, index->second);
+}
+
+auto BinaryModelWriter::write_model(const Model & model, const string & filename) -> void
+{
+    string header = binary_model_magic;
+    append_binary(header, binary_model_version);
+    append_binary(header, binary_model_byte_order);
+
+    // arrays are written as a whole, so that their elements don't need names
+    string variables;
+    uint64_t number_of_arrays = 0;
+    map<VariableID, long long> array_sizes;
+    model.for_each_variable_array([&] (const string & name, VariableID first, const vector<pair<int, int> > & index_ranges) {
+            ++number_of_arrays;
+            append_name(variables, name);
+            append_binary(variables, int32_t{ int{ first } });
+            append_binary(variables, uint32_t(index_ranges.size()));
+            long long size = 1;
+            for (auto & [ lower, upper ] : index_ranges) {
+                append_binary(variables, int32_t{ lower });
+                append_binary(variables, int32_t{ upper });
+                size *= (upper >= lower ? upper - lower + 1 : 0);
+            }
+            array_sizes.emplace(first, size);
+            append_domain(variables, size ? *model.get_variable(first)->original_values : set<VariableValue>{ });
+            });
+
+    auto in_array = [&] (VariableID id) {
+        auto a = array_sizes.upper_bound(id);
+        return a != array_sizes.begin() && int{ id } - int{ prev(a)->first } < prev(a)->second;
+    };
+
+    uint64_t number_of_variables = 0;
+    model.for_each_variable([&] (VariableID id, const Variable & v) {
+            if (in_array(id))
+                return;
+            ++number_of_variables;
+            append_binary(variables, int32_t{ int{ id } });
+            append_name(variables, model.original_name(id));
+            append_domain(variables, *v.original_values);
+            });
+
+    auto objective = model.objective();
+    append_binary(variables, uint32_t{ objective ? 1u : 0u });
+    append_binary(variables, int32_t{ objective ? int{ objective->first } : 0 });
+    append_binary(variables, uint32_t{ objective && objective->second == ObjectiveDirection::Maximize ? 1u : 0u });
+
+    model.for_each_constraint([&] (const Constraint & c) {
+            c.write_binary(*this);
+            });
+
+    string contents = header;
+    append_binary(contents, number_of_arrays);
+    append_binary(contents, number_of_variables);
+    contents.append(variables);
+    append_binary(contents, _imp->number_of_tables);
+    contents.append(_imp->tables);
+    append_binary(contents, _imp->number_of_constraints);
+    contents.append(_imp->constraints);
+
+    ofstream outfile{ filename, ios::binary };
+    if (! (outfile && outfile.write(contents.data(), contents.size())))
+        throw InputError{ "Cannot write compiled model to '" + filename + "'" };
+}
+
+auto write_binary_model(const Model & model, const string & filename) -> void
+{
+    BinaryModelWriter writer;
+    writer.write_model(model, filename);
+}
+
+auto is_binary_model(string_view contents) -> bool
+{
+    return 0 == contents.compare(0, binary_model_magic.size(), binary_model_magic);
+}
+
+namespace
+{
+struct BinaryModelReader
+{
+    string_view data;
+    size_t position = 0;
+
+    template <typename T_>
+    auto read() -> T_
+    {
+        if (data.size() - position < sizeof(T_))
+            throw InputError{ "Compiled model is truncated" };
+        T_ result;
+        memcpy(&result, data.data() + position, sizeof(T_));
+        position += sizeof(T_);
+        return result;
+    }
+
+    auto read_bytes(size_t size) -> string_view
+    {
+        if (data.size() - position < size)
+            throw InputError{ "Compiled model is truncated" };
+        auto result = data.substr(position, size);
+        position += size;
+        return result;
+    }
+
+    auto read_name() -> string
+    {
+        auto size = read<uint32_t>();
+        string result{ read_bytes(size) };
+        read_bytes((4 - size % 4) % 4);
+        return result;
+    }
+
+    auto read_domain() -> set<int>
+    {
+        set<int> result;
+        auto size = read<uint64_t>();
+        for (uint64_t v = 0 ; v < size ; ++v)
+            result.insert(result.end(), read<int32_t>());
+        return result;
+    }
+
+    auto read_variables() -> vector<VariableID>
+    {
+        auto size = read<uint64_t>();
+        vector<VariableID> result;
+        for (uint64_t i = 0 ; i < size ; ++i)
+            result.push_back(VariableID{ read<int32_t>() });
+        return result;
+    }
+};
+}
+
+auto read_binary_model(const shared_ptr<const MappedFile> & file) -> Model
+{
+    BinaryModelReader reader{ file->contents() };
+
+    reader.read_bytes(binary_model_magic.size());
+    if (reader.read<uint32_t>() != binary_model_version)
+        throw InputError{ "Compiled model was written by a different version of the solver" };
+    if (reader.read<uint32_t>() != binary_model_byte_order)
+        throw InputError{ "Compiled model was written on a machine with a different byte order" };
+
+    Model model;
+
+    VariablePool variables;
+
+    auto number_of_arrays = reader.read<uint64_t>();
+    auto number_of_variables = reader.read<uint64_t>();
+
+    for (uint64_t i = 0 ; i < number_of_arrays ; ++i) {
+        auto name = reader.read_name();
+        VariableID first{ reader.read<int32_t>() };
+        vector<pair<int, int> > index_ranges(reader.read<uint32_t>());
+        for (auto & [ lower, upper ] : index_ranges) {
+            lower = reader.read<int32_t>();
+            upper = reader.read<int32_t>();
+        }
+
+        if (! model.add_variable_array(name, first, index_ranges, *variables.make_variable(reader.read_domain())))
+            throw InputError{ "Duplicate variable '" + name + "' in compiled model" };
+    }
+
+    for (uint64_t i = 0 ; i < number_of_variables ; ++i) {
+        VariableID id{ reader.read<int32_t>() };
+        auto name = reader.read_name();
+        if (! model.add_variable(name, id, variables.make_variable(reader.read_domain())))
+            throw InputError{ "Duplicate variable '" + name + "' in compiled model" };
+    }
+
+    bool has_objective = reader.read<uint32_t>();
+    VariableID objective_variable{ reader.read<int32_t>() };
+    bool maximise = reader.read<uint32_t>();
+    if (has_objective)
+        model.set_objective(objective_variable, maximise ? ObjectiveDirection::Maximize : ObjectiveDirection::Minimize);
+
+    vector<shared_ptr<Table> > tables;
+    auto number_of_tables = reader.read<uint64_t>();
+    for (uint64_t t = 0 ; t < number_of_tables ; ++t) {
+        auto arity = reader.read<int32_t>();
+        auto number_of_tuples = reader.read<uint64_t>();
+        auto values = reader.read_bytes(number_of_tuples * arity * sizeof(int32_t));
+
+        if (0 != reinterpret_cast<uintptr_t>(values.data()) % alignof(int32_t))
+            throw InputError{ "Compiled model has a misaligned table" };
+
+        auto table = make_shared<Table>(arity);
+        table->use_mapped_values(reinterpret_cast<const int32_t *>(values.data()), number_of_tuples, file);
+        tables.push_back(table);
+    }
+
+    auto get_variable = [&] (VariableID v) {
+        if (! model.get_variable(v))
+            throw InputError{ "Compiled model refers to unknown variable " + to_string(int{ v }) };
+        return v;
+    };
+
+    auto number_of_constraints = reader.read<uint64_t>();
+    for (uint64_t c = 0 ; c < number_of_constraints ; ++c) {
+        switch (BinaryConstraintKind{ reader.read<uint32_t>() }) {
+            case BinaryConstraintKind::NotEqual: {
+                auto vars = reader.read_variables();
+                if (vars.size() != 2)
+                    throw InputError{ "Compiled model has a bad notequal constraint" };
+                model.add_constraint(make_shared<NotEqualConstraint>(get_variable(vars[0]), get_variable(vars[1])));
+                break;
+            }
+
+            case BinaryConstraintKind::EqualConstant: {
+                auto vars = reader.read_variables();
+                if (vars.size() != 1)
+                    throw InputError{ "Compiled model has a bad equal constraint" };
+                VariableValue value{ reader.read<int32_t>() };
+                model.add_constraint(make_shared<EqualConstantConstraint>(get_variable(vars[0]), value));
+                break;
+            }
+
+            case BinaryConstraintKind::AllDifferent: {
+                auto strength = AllDifferentStrength(reader.read<int32_t>());
+                auto vars = reader.read_variables();
+                for (auto & v : vars)
+                    get_variable(v);
+                model.add_constraint(make_shared<AllDifferentConstraint>(move(vars), strength));
+                break;
+            }
+
+            case BinaryConstraintKind::Table: {
+                auto index = reader.read<uint64_t>();
+                if (index >= tables.size())
+                    throw InputError{ "Compiled model refers to unknown table " + to_string(index) };
+                auto constraint = make_shared<TableConstraint>(tables[index]);
+                for (auto & v : reader.read_variables())
+                    constraint->associate_with_variable(get_variable(v));
+                model.add_constraint(constraint);
+                break;
+            }
+
+            default:
+                throw InputError{ "Compiled model has an unknown kind of constraint" };
+        }
+    }
+
+    return model;
+}
@@ -0,0 +1,65 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+#ifndef CERTIFIED_CONSTRAINT_SOLVER_GUARD_SRC_BINARY_MODEL_HH
+#define CERTIFIED_CONSTRAINT_SOLVER_GUARD_SRC_BINARY_MODEL_HH 1
+
+#include "binary_model-fwd.hh"
+#include "model-fwd.hh"
+#include "variable-fwd.hh"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class MappedFile;
+class Table;
+
+enum class BinaryConstraintKind : std::uint32_t
+{
+    NotEqual = 1,
+    EqualConstant = 2,
+    AllDifferent = 3,
+    Table = 4
+};
+
+/**
+ * Used by each constraint to describe itself when a model is compiled. Tables
+ * shared between constraints are only written once.
+ */
+class BinaryModelWriter
+{
+    private:
+        struct Imp;
+        std::unique_ptr<Imp> _imp;
+
+    public:
+        BinaryModelWriter();
+        BinaryModelWriter(const BinaryModelWriter &) = delete;
+        ~BinaryModelWriter();
+
+        auto operator= (const BinaryModelWriter &) -> BinaryModelWriter & = delete;
+
+        auto start_constraint(BinaryConstraintKind) -> void;
+        auto write_int(int) -> void;
+        auto write_variables(const std::vector<VariableID> &) -> void;
+        auto write_table(const std::shared_ptr<const Table> &) -> void;
+
+        auto write_model(const Model &, const std::string & filename) -> void;
+};
+
+/**
+ * Write a model in our binary format, which can be loaded without parsing.
+ */
+auto write_binary_model(const Model &, const std::string & filename) -> void;
+
+auto is_binary_model(std::string_view contents) -> bool;
+
+/**
+ * Load a model written by write_binary_model(). Tables point straight into the
+ * mapping, which is kept alive for as long as they are.
+ */
+auto read_binary_model(const std::shared_ptr<const MappedFile> &) -> Model;
+
+#endif
@@ -1,15 +1,21 @@
 /* vim: set sw=4 sts=4 et foldmethod=syntax : */
 
+#include "batch.hh"
+#include "binary_model.hh"
 #include "config.hh"
+#include "cubes.hh"
 #include "model.hh"
 #include "proof.hh"
 #include "read_model.hh"
 #include "result.hh"
 #include "solve.hh"
+#include "variable.hh"
 
 #include <boost/program_options.hpp>
 
+#include <atomic>
 #include <chrono>
+#include <csignal>
 #include <cstdlib>
 #include <ctime>
 #include <exception>
@@ -18,6 +24,7 @@
 #include <iostream>
 #include <memory>
 #include <optional>
+#include <thread>
 #include <vector>
 
 #include <unistd.h>
@@ -40,17 +47,24 @@ using boost::filesystem::path;
 
 namespace po = boost::program_options;
 
-using std::boolalpha;
+using std::atomic;
 using std::cerr;
+using std::cin;
 using std::copy;
 using std::cout;
 using std::endl;
 using std::exception;
+using std::ifstream;
 using std::localtime;
 using std::make_optional;
+using std::ofstream;
+using std::ostream;
 using std::optional;
 using std::put_time;
+using std::signal;
 using std::string;
+using std::thread;
+using std::to_string;
 using std::vector;
 
 using std::chrono::duration_cast;
@@ -60,8 +74,29 @@ using std::chrono::seconds;
 using std::chrono::steady_clock;
 using std::chrono::system_clock;
 
+namespace
+{
+atomic<bool> interrupted{ false };
+
+// search notices this and stops as if it had hit a limit, so we still write
+// out what we know, and finish off the proof. a second signal gets the
+// default behaviour, for when that takes too long.
+extern "C" auto interrupt(int signal_number) -> void
+{
+    interrupted = true;
+    signal(signal_number, SIG_DFL);
+}
+}
+
 auto main(int argc, char * argv[]) -> int
 {
+    signal(SIGINT, interrupt);
+    signal(SIGTERM, interrupt);
+
+    // if whatever is reading our output goes away, we still want to finish
+    // writing the proof, rather than being killed part way through
+    signal(SIGPIPE, SIG_IGN);
+
     try {
         po::options_description display_options{ "Program options" };
         display_options.add_options()
@@ -71,7 +106,34 @@ auto main(int argc, char * argv[]) -> int
             ("write-ref-to",    po::value<string>(),         "Specify the proof log file (default: input file with .log extension)")
             ("asserty",                                      "Generate lots of extra assertions in the proof")
             ("levels",                                       "Generate lvlset and lvlclear commands in the proof")
+            ("proof-comments",  po::value<string>(),         "How many comments to write in the proof (none, minimal, full)")
             ("numbered-variables",                           "Generate variables named x1, ..., xN rather than xVarVal")
+            ("search",          po::value<string>(),         "Specify the search strategy (dfs, lds, dds)")
+            ("variable-ordering", po::value<string>(),       "Specify the variable ordering (dom, domdeg, input)")
+            ("value-ordering",  po::value<string>(),         "Specify the value ordering (min, max, median, random, phase)")
+            ("seed",            po::value<unsigned>(),       "Specify the random seed for random value ordering")
+            ("hint",            po::value<string>(),         "Read a solution hint, in 'name = value' format, and try these values first")
+            ("all-solutions",                                "Find every solution, writing each one out as it is found")
+            ("count",                                        "Count every solution, without writing them out")
+            ("solutions-to",    po::value<string>(),         "Write solutions to this file rather than to standard output")
+            ("timeout",         po::value<int>(),            "Abort after this many seconds")
+            ("node-limit",      po::value<unsigned long long>(), "Abort after this many search nodes")
+            ("memory-limit",    po::value<unsigned long long>(), "Abort if memory use exceeds this many megabytes")
+            ("threads",         po::value<unsigned>(),       "Use this many threads for search (0 for one per core)")
+            ("write-cubes",     po::value<string>(),         "Split the problem into cubes, write them to this file, and stop")
+            ("cubes",           po::value<unsigned long long>(), "With --write-cubes, roughly how many cubes to produce (default 64)")
+            ("cube-file",       po::value<string>(),         "Read cubes from this file, for --solve-cube or --combine-cubes")
+            ("solve-cube",      po::value<unsigned long long>(), "Solve only this cube, counting from 0")
+            ("combine-cubes",                                "Combine the proofs for each cube into a single proof, and stop")
+            ("presolve",                                     "Simplify the model at the root before search")
+            ("probe",                                        "Make the model singleton arc consistent before search")
+            ("components",                                   "Solve independent parts of the problem separately, after propagating at the root")
+            ("parallel",        po::value<string>(),         "Specify how threads share work (steal, eps, portfolio)")
+            ("subproblems-per-thread", po::value<unsigned>(), "For --parallel eps, how many subproblems to create for each thread")
+            ("compile-model",   po::value<string>(),         "Write the model to this file in a binary format which loads quickly, and stop")
+            ("clues",           po::value<string>(),         "Treat the model as a template, and solve it with the clues in this file")
+            ("batch",                                        "Read a stream of model files or models from standard input, and solve each of them")
+            ("batch-delimiter", po::value<string>(),         "With --batch, the line separating instances (default ---)")
             ;
 
         po::positional_options_description positional_options;
@@ -100,6 +162,143 @@ auto main(int argc, char * argv[]) -> int
             return EXIT_SUCCESS;
         }
 
+        SolveOptions solve_options;
+        solve_options.interrupted = &interrupted;
+
+        if (options_vars.count("search")) {
+            auto search = options_vars["search"].as<string>();
+            if (search == "dfs")
+                solve_options.search_mode = SearchMode::DepthFirst;
+            else if (search == "lds")
+                solve_options.search_mode = SearchMode::LimitedDiscrepancy;
+            else if (search == "dds")
+                solve_options.search_mode = SearchMode::DepthBoundedDiscrepancy;
+            else
+                throw po::validation_error{ po::validation_error::invalid_option_value, "search", search };
+        }
+
+        if (options_vars.count("variable-ordering")) {
+            auto ordering = options_vars["variable-ordering"].as<string>();
+            if (ordering == "dom")
+                solve_options.variable_ordering = VariableOrdering::SmallestDomain;
+            else if (ordering == "domdeg")
+                solve_options.variable_ordering = VariableOrdering::DomainOverDegree;
+            else if (ordering == "input")
+                solve_options.variable_ordering = VariableOrdering::InputOrder;
+            else
+                throw po::validation_error{ po::validation_error::invalid_option_value, "variable-ordering", ordering };
+        }
+
+        if (options_vars.count("value-ordering")) {
+            auto ordering = options_vars["value-ordering"].as<string>();
+            if (ordering == "min")
+                solve_options.value_ordering = ValueOrdering::Min;
+            else if (ordering == "max")
+                solve_options.value_ordering = ValueOrdering::Max;
+            else if (ordering == "median")
+                solve_options.value_ordering = ValueOrdering::Median;
+            else if (ordering == "random")
+                solve_options.value_ordering = ValueOrdering::Random;
+            else if (ordering == "phase")
+                solve_options.value_ordering = ValueOrdering::PhaseSaving;
+            else
+                throw po::validation_error{ po::validation_error::invalid_option_value, "value-ordering", ordering };
+        }
+
+        if (options_vars.count("seed"))
+            solve_options.random_seed = options_vars["seed"].as<unsigned>();
+
+        if (options_vars.count("timeout"))
+            solve_options.timeout = seconds{ options_vars["timeout"].as<int>() };
+
+        if (options_vars.count("node-limit"))
+            solve_options.node_limit = options_vars["node-limit"].as<unsigned long long>();
+
+        if (options_vars.count("memory-limit"))
+            solve_options.memory_limit = options_vars["memory-limit"].as<unsigned long long>();
+
+        if (options_vars.count("threads")) {
+            solve_options.threads = options_vars["threads"].as<unsigned>();
+            if (0 == solve_options.threads)
+                solve_options.threads = thread::hardware_concurrency();
+
+            if (solve_options.threads > 1 && options_vars.count("prove") && ! options_vars.count("probe"))
+                throw po::error{ "--threads can only be used with --prove for --probe" };
+            if (solve_options.threads > 1 && solve_options.search_mode != SearchMode::DepthFirst)
+                throw po::error{ "--threads can only be used with depth-first search" };
+        }
+
+        if (options_vars.count("parallel")) {
+            auto parallel = options_vars["parallel"].as<string>();
+            if (parallel == "steal")
+                solve_options.parallel_mode = ParallelMode::WorkStealing;
+            else if (parallel == "eps")
+                solve_options.parallel_mode = ParallelMode::Decomposition;
+            else if (parallel == "portfolio")
+                solve_options.parallel_mode = ParallelMode::Portfolio;
+            else
+                throw po::validation_error{ po::validation_error::invalid_option_value, "parallel", parallel };
+
+            if (solve_options.parallel_mode != ParallelMode::WorkStealing && options_vars.count("prove"))
+                throw po::error{ "--parallel " + parallel + " cannot be used with --prove" };
+            if (solve_options.parallel_mode != ParallelMode::WorkStealing && solve_options.search_mode != SearchMode::DepthFirst)
+                throw po::error{ "--parallel " + parallel + " can only be used with depth-first search" };
+            if (solve_options.parallel_mode == ParallelMode::Portfolio && (options_vars.count("all-solutions") || options_vars.count("count")))
+                throw po::error{ "--parallel portfolio cannot be used with --all-solutions or --count" };
+
+            // a portfolio of one isn't very interesting
+            if (solve_options.parallel_mode == ParallelMode::Portfolio && ! options_vars.count("threads"))
+                solve_options.threads = thread::hardware_concurrency();
+        }
+
+        if (options_vars.count("presolve"))
+            solve_options.presolve = true;
+
+        if (options_vars.count("probe"))
+            solve_options.probe = true;
+
+        if (options_vars.count("components")) {
+            if (options_vars.count("prove"))
+                throw po::error{ "--components cannot be used with --prove" };
+            if (solve_options.search_mode != SearchMode::DepthFirst)
+                throw po::error{ "--components can only be used with depth-first search" };
+            if (options_vars.count("all-solutions") || options_vars.count("count"))
+                throw po::error{ "--components cannot be used with --all-solutions or --count" };
+            if (options_vars.count("parallel"))
+                throw po::error{ "--components shares threads out between components, and so cannot be used with --parallel" };
+            solve_options.components = true;
+        }
+
+        if (options_vars.count("subproblems-per-thread")) {
+            solve_options.subproblems_per_thread = options_vars["subproblems-per-thread"].as<unsigned>();
+            if (0 == solve_options.subproblems_per_thread)
+                throw po::validation_error{ po::validation_error::invalid_option_value, "subproblems-per-thread", "0" };
+        }
+
+        if (options_vars.count("batch")) {
+            for (auto & option : { "prove", "hint", "clues", "all-solutions", "count", "solutions-to", "parallel", "write-cubes", "solve-cube", "combine-cubes", "compile-model" })
+                if (options_vars.count(option))
+                    throw po::error{ "--" + string{ option } + " cannot be used with --batch" };
+
+            string delimiter = options_vars.count("batch-delimiter") ? options_vars["batch-delimiter"].as<string>() : "---";
+            if (delimiter.empty())
+                throw po::validation_error{ po::validation_error::invalid_option_value, "batch-delimiter", delimiter };
+
+            // --threads says how many instances to solve at once
+            unsigned threads = options_vars.count("threads") ? solve_options.threads : 1;
+
+            // with a model file, each instance is a set of clues for it
+            optional<Model> model_template;
+            if (options_vars.count("model-file")) {
+                model_template.emplace(read_model(options_vars["model-file"].as<string>()));
+                cout << "model_template = " << options_vars["model-file"].as<string>() << endl;
+            }
+
+            auto instances = run_batch(cin, cout, solve_options, threads, delimiter, model_template);
+            cout << "instances = " << instances << endl;
+            return EXIT_SUCCESS;
+        }
+
         /* No algorithm or no input file specified? Show a message and exit. */
         if (! options_vars.count("model-file")) {
             cout << "Usage: " << argv[0] << " [options] model" << endl;
@@ -121,58 +320,179 @@ auto main(int argc, char * argv[]) -> int
 
         cout << "model_file = " << options_vars["model-file"].as<string>() << endl;
 
+        if (options_vars.count("compile-model")) {
+            write_binary_model(model, options_vars["compile-model"].as<string>());
+            cout << "compiled_model = " << options_vars["compile-model"].as<string>() << endl;
+            return EXIT_SUCCESS;
+        }
+
         /* Start the clock */
         auto start_time = steady_clock::now();
 
-        optional<Proof> proof;
-        if (options_vars.count("prove")) {
-            path opb_file;
-            if (options_vars.count("write-opb-to"))
-                opb_file = options_vars["write-opb-to"].as<string>();
-            else {
-                opb_file = options_vars["model-file"].as<string>();
-                opb_file = opb_file.replace_extension(".opb");
-            }
+        if (options_vars.count("solve-cube") + options_vars.count("combine-cubes") + options_vars.count("write-cubes") > 1)
+            throw po::error{ "Only one of --write-cubes, --solve-cube, and --combine-cubes can be used at once" };
+        if ((options_vars.count("solve-cube") || options_vars.count("combine-cubes")) && ! options_vars.count("cube-file"))
+            throw po::error{ "--solve-cube and --combine-cubes need --cube-file" };
+
+        // each cube gets its own proof, so that they can be solved at once
+        string proof_suffix;
+        if (options_vars.count("solve-cube"))
+            proof_suffix = ".cube" + to_string(options_vars["solve-cube"].as<unsigned long long>());
 
-            path log_file;
-            if (options_vars.count("write-ref-to"))
-                log_file = options_vars["write-ref-to"].as<string>();
-            else {
-                log_file = options_vars["model-file"].as<string>();
-                log_file = log_file.replace_extension(".log");
+        path opb_file;
+        if (options_vars.count("write-opb-to"))
+            opb_file = options_vars["write-opb-to"].as<string>();
+        else {
+            opb_file = options_vars["model-file"].as<string>();
+            opb_file = opb_file.replace_extension(proof_suffix + ".opb");
+        }
+
+        path log_file;
+        if (options_vars.count("write-ref-to"))
+            log_file = options_vars["write-ref-to"].as<string>();
+        else {
+            log_file = options_vars["model-file"].as<string>();
+            log_file = log_file.replace_extension(proof_suffix + ".log");
+        }
+
+        if (options_vars.count("combine-cubes")) {
+            auto cubes = read_cubes(options_vars["cube-file"].as<string>(), model);
+            vector<string> cube_logs;
+            for (unsigned long long i = 0 ; i < cubes.size() ; ++i) {
+                path cube_log = log_file;
+                cube_logs.push_back(cube_log.replace_extension(".cube" + to_string(i) + ".log").string());
             }
 
+            combine_cube_proofs(log_file.string(), cube_logs, log_file.string());
+            cout << "combined_cubes = " << cubes.size() << endl;
+            return EXIT_SUCCESS;
+        }
+
+        optional<Proof> proof;
+        if (options_vars.count("prove")) {
             bool asserty = options_vars.count("asserty");
             bool levels = options_vars.count("levels");
             bool numbered_variables = options_vars.count("numbered-variables");
 
+            ProofComments comments = ProofComments::Full;
+            if (options_vars.count("proof-comments")) {
+                auto level = options_vars["proof-comments"].as<string>();
+                if (level == "none")
+                    comments = ProofComments::None;
+                else if (level == "minimal")
+                    comments = ProofComments::Minimal;
+                else if (level == "full")
+                    comments = ProofComments::Full;
+                else
+                    throw po::validation_error{ po::validation_error::invalid_option_value, "proof-comments", level };
+            }
+
 #if defined(STD_FS_IS_BOOST)
-            proof = make_optional<Proof>(opb_file.string(), log_file.string(), asserty, levels, numbered_variables);
+            proof = make_optional<Proof>(opb_file.string(), log_file.string(), asserty, levels, numbered_variables, comments);
 #else
-            proof = make_optional<Proof>(opb_file, log_file, asserty, levels, numbered_variables);
+            proof = make_optional<Proof>(opb_file, log_file, asserty, levels, numbered_variables, comments);
 #endif
         }
 
-        auto result = solve(model, proof);
+        if (options_vars.count("solve-cube")) {
+            if (model.objective())
+                throw po::error{ "--solve-cube cannot be used with an objective" };
 
-        /* Stop the clock. */
-        auto overall_time = duration_cast<milliseconds>(steady_clock::now() - start_time);
+            auto cubes = read_cubes(options_vars["cube-file"].as<string>(), model);
+            auto index = options_vars["solve-cube"].as<unsigned long long>();
+            if (index >= cubes.size())
+                throw po::validation_error{ po::validation_error::invalid_option_value, "solve-cube", to_string(index) };
+            solve_options.assumptions = cubes[index];
+        }
 
-        cout << "status = ";
-        if (! result.solution.empty())
-            cout << "true";
-        else
-            cout << "false";
-        cout << endl;
+        if (options_vars.count("clues")) {
+            if (options_vars.count("solve-cube") || options_vars.count("write-cubes"))
+                throw po::error{ "--clues cannot be used with --solve-cube or --write-cubes" };
 
-        cout << "nodes = " << result.nodes << endl;
-        cout << "runtime = " << overall_time.count() << endl;
+            // the clues are treated as assumptions, so any proof is for the
+            // template, and the same OPB file serves for every set of clues
+            ifstream clues_file{ options_vars["clues"].as<string>() };
+            if (! clues_file)
+                throw po::error{ "Cannot read clues from '" + options_vars["clues"].as<string>() + "'" };
+            solve_options.assumptions = read_clues(clues_file, model);
+        }
+
+        if (options_vars.count("write-cubes")) {
+            if (model.objective())
+                throw po::error{ "--write-cubes cannot be used with an objective" };
+
+            ofstream cubes_file{ options_vars["write-cubes"].as<string>() };
+            if (! cubes_file)
+                throw po::error{ "Cannot write cubes to '" + options_vars["write-cubes"].as<string>() + "'" };
+
+            auto cube_result = generate_cubes(model, proof,
+                    options_vars.count("cubes") ? options_vars["cubes"].as<unsigned long long>() : 64);
+            write_cubes(cubes_file, model, cube_result.cubes);
+            if (proof)
+                proof->close();
+
+            auto overall_time = duration_cast<milliseconds>(steady_clock::now() - start_time);
+
+            // if there are no cubes, we've solved the problem already
+            if (cube_result.cubes.empty())
+                cout << "status = false" << endl;
+            cout << "cubes = " << cube_result.cubes.size() << endl;
+            cout << "nodes = " << cube_result.nodes << endl;
+            cout << "runtime = " << overall_time.count() << endl;
+            return EXIT_SUCCESS;
+        }
+
+        if (options_vars.count("hint"))
+            solve_options.hints = read_hints(options_vars["hint"].as<string>(), model);
+
+        ofstream solutions_file;
+        if (options_vars.count("solutions-to")) {
+            solutions_file.open(options_vars["solutions-to"].as<string>());
+            if (! solutions_file)
+                throw po::error{ "Cannot write solutions to '" + options_vars["solutions-to"].as<string>() + "'" };
+        }
+        ostream & solutions_stream = solutions_file.is_open() ? solutions_file : cout;
+
+        if (options_vars.count("all-solutions") || options_vars.count("count")) {
+            if (solve_options.search_mode != SearchMode::DepthFirst)
+                throw po::error{ "--all-solutions and --count can only be used with depth-first search" };
+            if (model.objective())
+                throw po::error{ "--all-solutions and --count cannot be used with an objective" };
 
-        if (! result.solution.empty()) {
-            for (auto & [ k, v ] : result.solution)
-                cout << k << " = " << v << endl;
+            solve_options.all_solutions = true;
+            if (! options_vars.count("count"))
+                solve_options.on_solution = [&] (const Model & m) {
+                    solutions_stream << "solution =";
+                    m.for_each_variable([&] (VariableID name, const Variable & v) {
+                            solutions_stream << " " << m.original_name(name) << "=" << int{ *v.values.begin() };
+                            });
+                    solutions_stream << '\n';
+                };
         }
 
+        if (auto objective = model.objective())
+            solve_options.on_solution = [&, objective_variable_name = objective->first] (const Model & m) {
+                auto so_far = duration_cast<milliseconds>(steady_clock::now() - start_time);
+                cout << "incumbent = " << int{ *m.get_variable(objective_variable_name)->values.begin() }
+                    << " (after " << so_far.count() << " ms)" << endl;
+            };
+
+        auto result = solve(model, proof, solve_options);
+
+        // the cube is only refuted if we looked at everything underneath it,
+        // and when enumerating, the proof has already excluded any solutions
+        if (proof && options_vars.count("solve-cube") && (! result.aborted)
+                && (solve_options.all_solutions || 0 == result.solution_count))
+            finish_cube_proof(*proof);
+
+        /* Stop the clock. */
+        auto overall_time = duration_cast<milliseconds>(steady_clock::now() - start_time);
+
+        write_result(cout, result, solve_options, overall_time);
+
+        if (proof)
+            proof->close();
+
         return EXIT_SUCCESS;
     }
     catch (const po::error & e) {
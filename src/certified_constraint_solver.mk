@@ -1,24 +1,14 @@
 TARGET := certified_constraint_solver
 
 SOURCES := \
-    all_different_constraint.cc \
-    certified_constraint_solver.cc \
-    constraint.cc \
-    model.cc \
-    not_equals_constraint.cc \
-    equals_constant_constraint.cc \
-    proof.cc \
-    read_model.cc \
-    solve.cc \
-    table_constraint.cc \
-    variable.cc
+    certified_constraint_solver.cc
 
-TGT_PREREQS := run-tests.bash
+TGT_PREREQS := libcertified_constraint_solver.a solver_test run-tests.bash
 
 ifeq ($(shell uname -s), Linux)
-TGT_LDLIBS := $(boost_ldlibs) -lstdc++fs
+TGT_LDLIBS := libcertified_constraint_solver.a $(boost_ldlibs) -lstdc++fs
 else
-TGT_LDLIBS := $(boost_ldlibs)
+TGT_LDLIBS := libcertified_constraint_solver.a $(boost_ldlibs)
 endif
 
 TGT_POSTMAKE := bash ./run-tests.bash
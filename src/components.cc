@@ -0,0 +1,152 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+#include "components.hh"
+#include "model.hh"
+#include "proof.hh"
+#include "result.hh"
+#include "scratch.hh"
+#include "variable.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using std::atomic;
+using std::make_unique;
+using std::max;
+using std::min;
+using std::nullopt;
+using std::optional;
+using std::stable_sort;
+using std::string;
+using std::thread;
+using std::to_string;
+using std::unique_ptr;
+using std::vector;
+
+using std::chrono::steady_clock;
+
+namespace
+{
+struct ComponentWorker
+{
+    Result result;
+    optional<Proof> no_proof;
+    SearchState state;
+    SearchOutcome outcome = SearchOutcome::Aborted;
+
+    ComponentWorker(const SolveOptions & options, atomic<unsigned long long> & total_nodes, const atomic<bool> & stop) :
+        state(options, result, no_proof)
+    {
+        state.total_nodes = &total_nodes;
+        state.stop = &stop;
+    }
+};
+}
+
+auto component_search(
+        const Model & model,
+        const SolveOptions & options,
+        const optional<steady_clock::time_point> & deadline,
+        Result & result) -> SearchOutcome
+{
+    ++result.nodes;
+
+    Model root = model;
+    optional<Proof> no_proof;
+    if (! root.propagate(no_proof))
+        return SearchOutcome::Exhausted;
+
+    auto components = root.independent_components();
+    result.components = components.size();
+
+    // biggest first, so that the small ones can fill in around it
+    vector<unsigned long long> sizes(components.size()), order(components.size());
+    for (unsigned c = 0 ; c < components.size() ; ++c) {
+        components[c].for_each_variable([&] (VariableID, const Variable &) { ++sizes[c]; });
+        order[c] = c;
+    }
+    stable_sort(order.begin(), order.end(), [&] (unsigned long long a, unsigned long long b) {
+            return sizes[a] > sizes[b];
+            });
+
+    atomic<unsigned long long> total_nodes{ result.nodes };
+    atomic<bool> stop{ false }, failed{ false };
+    atomic<unsigned long long> next_component{ 0 }, scratch_allocations{ 0 };
+
+    vector<unique_ptr<ComponentWorker> > workers;
+    for (unsigned c = 0 ; c < components.size() ; ++c) {
+        workers.push_back(make_unique<ComponentWorker>(options, total_nodes, stop));
+        workers.back()->state.objective = components[c].objective();
+        workers.back()->state.deadline = deadline;
+    }
+
+    auto run = [&] () {
+        auto scratch_allocations_before = scratch_heap_allocations();
+        for (auto n = next_component++ ; n < components.size() ; n = next_component++) {
+            auto c = order[n];
+            auto & worker = *workers[c];
+            worker.outcome = search(0, 0, worker.state, components[c]);
+
+            // an exhausted component either has no solutions, or has
+            // finished optimising. if it has no solutions, nothing does.
+            if (SearchOutcome::Exhausted == worker.outcome && ! worker.result.objective_value) {
+                failed = true;
+                stop = true;
+            }
+        }
+        scratch_allocations += scratch_heap_allocations() - scratch_allocations_before;
+    };
+
+    vector<thread> threads;
+    for (unsigned t = 0 ; t < max(1u, min<unsigned>(options.threads, components.size())) ; ++t)
+        threads.emplace_back(run);
+    for (auto & t : threads)
+        t.join();
+
+    result.scratch_allocations += scratch_allocations;
+
+    bool complete = ! failed;
+    for (auto & w : workers) {
+        result.nodes += w->result.nodes;
+        if (w->result.aborted && ! result.aborted)
+            result.aborted = w->result.aborted;
+        if (w->result.solution.empty())
+            complete = false;
+    }
+
+    if (failed) {
+        result.aborted = nullopt;
+        return SearchOutcome::Exhausted;
+    }
+
+    // stitch the pieces together, along with anything that was fixed at the
+    // root and so isn't in any component
+    if (complete) {
+        root.for_each_variable([&] (VariableID name, const Variable & v) {
+                if (1 == v.values.size()) {
+                    result.solution.emplace(root.original_name(name), to_string(int{ *v.values.begin() }));
+                    result.values.emplace(name, *v.values.begin());
+                }
+                });
+        for (auto & w : workers) {
+            result.solution.insert(w->result.solution.begin(), w->result.solution.end());
+            result.values.insert(w->result.values.begin(), w->result.values.end());
+            if (w->result.objective_value)
+                result.objective_value = w->result.objective_value;
+        }
+
+        if (auto objective = root.objective(); objective && ! result.objective_value)
+            result.objective_value = int{ *root.get_variable(objective->first)->values.begin() };
+
+        result.solution_count = 1;
+    }
+
+    if (result.aborted)
+        return SearchOutcome::Aborted;
+
+    return root.objective() ? SearchOutcome::Exhausted : SearchOutcome::Satisfied;
+}
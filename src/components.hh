@@ -0,0 +1,26 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+#ifndef CERTIFIED_CONSTRAINT_SOLVER_GUARD_SRC_COMPONENTS_HH
+#define CERTIFIED_CONSTRAINT_SOLVER_GUARD_SRC_COMPONENTS_HH 1
+
+#include "model-fwd.hh"
+#include "result-fwd.hh"
+#include "search.hh"
+#include "solve.hh"
+
+#include <chrono>
+#include <optional>
+
+/**
+ * Propagate at the root, and then solve each group of variables that shares
+ * no constraints with any other group separately, using several threads if
+ * asked. If any group has no solution, everything stops. Does not support
+ * proof logging, discrepancy search, or finding all solutions.
+ */
+auto component_search(
+        const Model & model,
+        const SolveOptions & options,
+        const std::optional<std::chrono::steady_clock::time_point> & deadline,
+        Result & result) -> SearchOutcome;
+
+#endif
@@ -5,4 +5,6 @@
 
 struct Constraint;
 
+enum class AllDifferentStrength;
+
 #endif
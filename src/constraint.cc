@@ -2,5 +2,12 @@
 
 #include "constraint.hh"
 
+using std::nullopt;
+using std::optional;
+
 Constraint::~Constraint() = default;
 
+auto Constraint::all_different_strength(const Model &) const -> optional<AllDifferentStrength>
+{
+    return nullopt;
+}
@@ -7,7 +7,9 @@
 #include "model-fwd.hh"
 #include "proof-fwd.hh"
 #include "variable-fwd.hh"
+#include "binary_model-fwd.hh"
 
+#include <memory_resource>
 #include <optional>
 #include <set>
 #include <string>
@@ -23,13 +25,24 @@ struct Constraint
     [[ nodiscard ]] virtual auto propagate(
             Model & model,
             std::optional<Proof> &,
-            std::set<VariableID> & changed_variables) const -> bool = 0;
+            std::pmr::set<VariableID> & changed_variables) const -> bool = 0;
 
     virtual auto start_proof(const Model &, Proof &) -> void = 0;
 
     virtual auto associated_variables() const -> std::set<VariableID> = 0;
 
     virtual auto priority() const -> int = 0;
+
+    virtual auto write_binary(BinaryModelWriter &) const -> void = 0;
+
+    // true if every way of picking from what is left of our variables'
+    // domains satisfies us, so propagating us can never do anything again
+    [[ nodiscard ]] virtual auto entailed(const Model &) const -> bool = 0;
+
+    // if all we do is require our variables to take different values, how
+    // strongly we propagate that, which lets presolve spot constraints that
+    // another constraint makes redundant
+    virtual auto all_different_strength(const Model &) const -> std::optional<AllDifferentStrength>;
 };
 
 #endif
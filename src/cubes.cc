@@ -0,0 +1,353 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+#include "cubes.hh"
+#include "model.hh"
+#include "proof.hh"
+#include "read_model.hh"
+#include "result.hh"
+#include "search.hh"
+#include "solve.hh"
+#include "variable.hh"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <memory>
+#include <sstream>
+
+using std::all_of;
+using std::endl;
+using std::find;
+using std::getline;
+using std::ifstream;
+using std::move;
+using std::next;
+using std::nullopt;
+using std::ofstream;
+using std::optional;
+using std::ostream;
+using std::pair;
+using std::shared_ptr;
+using std::string;
+using std::stoll;
+using std::stringstream;
+using std::to_string;
+using std::vector;
+
+const string cube_proofs_marker = "* proofs for each cube go here";
+const string cube_refuted_marker = "* cube refuted";
+
+namespace
+{
+// pick the variable whose values leave the fewest children that survive
+// propagation, breaking ties by preferring whichever makes propagation remove
+// the most values. this is expensive, but we only do it near the top of the
+// tree.
+auto lookahead_branch_variable(const Model & model, unsigned long long & survivors) -> pair<VariableID, shared_ptr<Variable> >
+{
+    pair<VariableID, shared_ptr<Variable> > result;
+    pair<unsigned long long, unsigned long long> best_score;
+
+    model.for_each_variable([&] (VariableID name, const Variable & v) {
+            if (v.values.size() == 1)
+                return;
+
+            pair<unsigned long long, unsigned long long> score{ 0, 0 };
+            for (auto & value : v.values) {
+                Model probe = model;
+                probe.get_variable(name)->values = {{ value }};
+                optional<Proof> no_proof;
+                if (probe.propagate(no_proof)) {
+                    ++score.first;
+                    probe.for_each_variable([&] (VariableID, const Variable & w) {
+                            score.second += w.values.size();
+                            });
+                }
+            }
+
+            if ((! result.second) || score < best_score) {
+                result = pair{ name, model.get_variable(name) };
+                best_score = score;
+            }
+            });
+
+    survivors = best_score.first;
+    return result;
+}
+
+// returns true if we produced any cubes, and false if everything underneath
+// here was refuted
+auto generate_cubes_from(int depth, unsigned long long target, SearchState & state, const Model & model,
+        Cube & current, CubeResult & result, vector<string> & deferred_lines) -> bool
+{
+    auto & proof = state.proof;
+
+    unsigned long long survivors = 0;
+    auto [ branch_variable_name, branch_variable ] = lookahead_branch_variable(model, survivors);
+    if ((! branch_variable) || target <= 1) {
+        if (proof && proof->comments(ProofComments::Full))
+            proof->proof_stream() << "* writing cube " << result.cubes.size() << endl;
+        result.cubes.push_back(current);
+        return true;
+    }
+
+    if (proof && proof->comments(ProofComments::Full))
+        proof->proof_stream() << "* branching at depth " << depth << endl;
+
+    // share out what's left between the children that survived lookahead
+    auto child_target = (target + survivors - 1) / (survivors == 0 ? 1 : survivors);
+    bool produced_cubes = false;
+    for (auto & value : branch_variable->values) {
+        current.emplace_back(branch_variable_name, value);
+        if (proof)
+            proof->enstackinate_guess(branch_variable_name, model.original_name(branch_variable_name), value);
+
+        ++result.nodes;
+        Model child = model;
+        child.get_variable(branch_variable_name)->values = {{ value }};
+        if (propagate_node(depth + 1, state, child) &&
+                generate_cubes_from(depth + 1, child_target, state, child, current, result, deferred_lines)) {
+            // we can't say this guess was wrong until we have seen the proofs
+            // for the cubes underneath it
+            produced_cubes = true;
+            if (proof) {
+                deferred_lines.push_back(proof->incorrect_guess_line());
+                proof->undo_guess();
+            }
+        }
+        else if (proof)
+            proof->incorrect_guess();
+
+        current.pop_back();
+    }
+
+    return produced_cubes;
+}
+}
+
+auto generate_cubes(const Model & model, optional<Proof> & proof, unsigned long long target) -> CubeResult
+{
+    if (proof)
+        model.start_proof(*proof);
+
+    SolveOptions options;
+    Result search_result;
+    SearchState state{ options, search_result, proof };
+
+    CubeResult result;
+    vector<string> deferred_lines;
+
+    ++result.nodes;
+    Model root = model;
+    Cube current;
+    bool produced_cubes = propagate_node(0, state, root) &&
+        generate_cubes_from(0, target, state, root, current, result, deferred_lines);
+
+    if (proof) {
+        // everything from here onwards depends upon the cubes being refuted
+        if (produced_cubes) {
+            proof->proof_stream() << cube_proofs_marker << endl;
+            for (auto & line : deferred_lines) {
+                proof->proof_stream() << line << endl;
+                proof->next_proof_line();
+            }
+        }
+
+        proof->proof_stream() << "u >= 1 ;" << endl;
+        proof->next_proof_line();
+        proof->proof_stream() << "c " << proof->last_proof_line() << " 0" << endl;
+    }
+
+    return result;
+}
+
+auto write_cubes(ostream & stream, const Model & model, const vector<Cube> & cubes) -> void
+{
+    for (auto & cube : cubes) {
+        stream << "cube";
+        for (auto & [ var, val ] : cube)
+            stream << " " << model.original_name(var) << "=" << int{ val };
+        stream << '\n';
+    }
+}
+
+auto finish_cube_proof(Proof & proof) -> void
+{
+    proof.proof_stream() << cube_refuted_marker << endl;
+}
+
+auto read_cubes(const string & filename, const Model & model) -> vector<Cube>
+{
+    ifstream infile{ filename };
+    if (! infile)
+        throw InputError{ "Error reading from '" + filename + "'" };
+
+    vector<Cube> result;
+    string line;
+    while (getline(infile, line)) {
+        stringstream ss{ line };
+        string word;
+        if (! (ss >> word))
+            continue;
+        if (word != "cube")
+            throw InputError{ "Expected 'cube' in '" + filename + "'" };
+
+        Cube cube;
+        while (ss >> word) {
+            auto eq = word.rfind('=');
+            auto var = string::npos == eq ? nullopt : model.find_variable(word.substr(0, eq));
+            if (! var)
+                throw InputError{ "Bad assignment '" + word + "' in cubes" };
+
+            stringstream vs{ word.substr(eq + 1) };
+            int val;
+            if (! (vs >> val))
+                throw InputError{ "Bad assignment '" + word + "' in cubes" };
+            cube.emplace_back(*var, VariableValue{ val });
+        }
+
+        result.push_back(move(cube));
+    }
+
+    return result;
+}
+
+namespace
+{
+auto read_proof_lines(const string & filename) -> vector<string>
+{
+    ifstream infile{ filename };
+    if (! infile)
+        throw ProofError{ "Cannot read proof log from '" + filename + "'" };
+
+    vector<string> result;
+    string line;
+    while (getline(infile, line))
+        result.push_back(line);
+
+    if (result.size() < 2)
+        throw ProofError{ "Proof log '" + filename + "' is too short" };
+
+    return result;
+}
+
+// how many constraints a line of a proof log introduces, ignoring the line
+// that loads the model
+auto derived_constraints(const string & line) -> long long
+{
+    if (line.size() >= 2 && line[1] == ' ' && (line[0] == 'u' || line[0] == 'p' || line[0] == 'v' || line[0] == 'o'))
+        return 1;
+    return 0;
+}
+
+auto is_number(const string & token) -> bool
+{
+    return (! token.empty()) && all_of(token.begin(), token.end(), [] (char c) { return c >= '0' && c <= '9'; });
+}
+
+// shift every reference to a derived constraint by offset. numbers in the
+// model are left alone. p lines are in reverse polish notation, where the
+// operand just before a * or a d is a multiplier or divisor rather than a
+// constraint, and anything we don't understand is an error rather than
+// something to guess about.
+auto renumber(const string & line, long long model_constraints, long long offset) -> string
+{
+    if (0 == offset || line.size() < 2 || line[1] != ' ' || (line[0] != 'p' && line[0] != 'c'))
+        return line;
+
+    vector<string> tokens;
+    stringstream ss{ line };
+    string token;
+    while (ss >> token)
+        tokens.push_back(token);
+
+    vector<bool> is_reference(tokens.size(), false);
+    for (unsigned i = 1 ; i < tokens.size() ; ++i) {
+        if (is_number(tokens[i]))
+            is_reference[i] = true;
+        else if (tokens[i] == "*" || tokens[i] == "d") {
+            if (! is_reference[i - 1])
+                throw ProofError{ "Expected a number before '" + tokens[i] + "' in '" + line + "'" };
+            is_reference[i - 1] = false;
+        }
+        else if (line[0] == 'c' || ! (tokens[i] == "+" || tokens[i] == "s" || tokens[i] == "w"
+                    || tokens[i][0] == 'x' || tokens[i][0] == '~'))
+            throw ProofError{ "Cannot renumber '" + tokens[i] + "' in '" + line + "'" };
+    }
+
+    string result = tokens[0];
+    for (unsigned i = 1 ; i < tokens.size() ; ++i) {
+        if (is_reference[i] && stoll(tokens[i]) > model_constraints)
+            result += " " + to_string(stoll(tokens[i]) + offset);
+        else
+            result += " " + tokens[i];
+    }
+
+    return result;
+}
+}
+
+auto combine_cube_proofs(const string & root_log, const vector<string> & cube_logs, const string & output_log) -> void
+{
+    auto root = read_proof_lines(root_log);
+
+    long long model_constraints;
+    {
+        stringstream ss{ root[1] };
+        string f;
+        if (! (ss >> f >> model_constraints) || f != "f")
+            throw ProofError{ "Proof log '" + root_log + "' does not start by loading the model" };
+    }
+
+    auto marker = find(root.begin(), root.end(), cube_proofs_marker);
+    if (marker == root.end())
+        throw ProofError{ "Proof log '" + root_log + "' does not say where the cube proofs go" };
+
+    // read everything before we start writing, in case the output replaces
+    // the input
+    vector<vector<string> > cubes;
+    for (auto & cube_log : cube_logs) {
+        cubes.push_back(read_proof_lines(cube_log));
+        if (cubes.back()[0] != root[0] || cubes.back()[1] != root[1])
+            throw ProofError{ "Proof log '" + cube_log + "' was not produced for the same model as '" + root_log + "'" };
+
+        // a cube that was satisfiable, or where we gave up, or whose log was
+        // cut short, would leave a hole in the combined proof
+        if (cubes.back().back() != cube_refuted_marker)
+            throw ProofError{ "Proof log '" + cube_log + "' does not refute its cube" };
+        cubes.back().pop_back();
+    }
+
+    stringstream combined;
+    long long before_marker = 0;
+    for (auto line = root.begin() ; line != marker ; ++line) {
+        combined << *line << '\n';
+        if (line - root.begin() >= 2)
+            before_marker += derived_constraints(*line);
+    }
+
+    // each cube was numbered as if it came straight after the model, and
+    // everything after the marker as if it came straight after everything
+    // before the marker
+    long long from_cubes = 0;
+    for (unsigned c = 0 ; c < cubes.size() ; ++c) {
+        combined << "* proof for cube " << c << '\n';
+        auto offset = before_marker + from_cubes;
+        for (unsigned i = 2 ; i < cubes[c].size() ; ++i) {
+            // an empty cube has a complete proof, but we aren't done yet
+            if (0 == cubes[c][i].compare(0, 2, "c "))
+                continue;
+            combined << renumber(cubes[c][i], model_constraints, offset) << '\n';
+            from_cubes += derived_constraints(cubes[c][i]);
+        }
+    }
+
+    for (auto line = next(marker) ; line != root.end() ; ++line)
+        combined << renumber(*line, model_constraints, from_cubes) << '\n';
+
+    ofstream outfile{ output_log };
+    if (! outfile)
+        throw ProofError{ "Cannot write proof log to '" + output_log + "'" };
+    outfile << combined.rdbuf();
+}
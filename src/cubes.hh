@@ -0,0 +1,52 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+#ifndef CERTIFIED_CONSTRAINT_SOLVER_GUARD_SRC_CUBES_HH
+#define CERTIFIED_CONSTRAINT_SOLVER_GUARD_SRC_CUBES_HH 1
+
+#include "model-fwd.hh"
+#include "proof-fwd.hh"
+#include "variable-fwd.hh"
+
+#include <iosfwd>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+using Cube = std::vector<std::pair<VariableID, VariableValue> >;
+
+struct CubeResult
+{
+    unsigned long long nodes = 0;
+    std::vector<Cube> cubes;
+};
+
+/**
+ * Split the problem into roughly the requested number of cubes, using
+ * lookahead to pick branching variables. Together with the refutations
+ * written to the proof, the cubes cover the entire search space. If there
+ * are any cubes, the proof contains a marker where the proofs for each cube
+ * must be inserted using combine_cube_proofs().
+ */
+auto generate_cubes(const Model &, std::optional<Proof> &, unsigned long long target) -> CubeResult;
+
+/**
+ * Mark the proof produced by solve() for a single cube as complete. This
+ * must only be called if the cube was refuted.
+ */
+auto finish_cube_proof(Proof &) -> void;
+
+auto write_cubes(std::ostream &, const Model &, const std::vector<Cube> &) -> void;
+
+auto read_cubes(const std::string & filename, const Model &) -> std::vector<Cube>;
+
+/**
+ * Splice the proofs produced by solving each cube into the proof produced
+ * by generate_cubes(), renumbering as necessary, to give a proof for the
+ * entire problem. Throws ProofError if any cube's proof was not finished
+ * using finish_cube_proof().
+ */
+auto combine_cube_proofs(const std::string & root_log, const std::vector<std::string> & cube_logs,
+        const std::string & output_log) -> void;
+
+#endif
@@ -0,0 +1,195 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+#include "domain.hh"
+
+#include <atomic>
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <set>
+#include <utility>
+
+using std::atomic_thread_fence;
+using std::initializer_list;
+using std::make_shared;
+using std::memory_order_acquire;
+using std::move;
+using std::set;
+using std::shared_ptr;
+using std::size_t;
+using std::uint64_t;
+
+namespace
+{
+auto in_small_range(VariableValue v) -> bool
+{
+    return int{ v } >= 0 && int{ v } < Domain::small_limit;
+}
+
+auto bit(VariableValue v) -> uint64_t
+{
+    return uint64_t{ 1 } << int{ v };
+}
+
+// every bit for values at least v
+auto bits_from(VariableValue v) -> uint64_t
+{
+    if (int{ v } <= 0)
+        return ~uint64_t{ 0 };
+    else if (int{ v } >= Domain::small_limit)
+        return 0;
+    else
+        return ~uint64_t{ 0 } << int{ v };
+}
+}
+
+Domain::Domain(const shared_ptr<set<VariableValue> > & values) :
+    _values(values)
+{
+    _make_small_if_possible();
+}
+
+Domain::Domain(initializer_list<VariableValue> values) :
+    _values(make_shared<set<VariableValue> >(values))
+{
+    _make_small_if_possible();
+}
+
+auto Domain::_make_small_if_possible() -> void
+{
+    if (_values->empty() || (in_small_range(*_values->begin()) && in_small_range(*_values->rbegin()))) {
+        _bits = 0;
+        for (auto & v : *_values)
+            _bits |= bit(v);
+        _values.reset();
+    }
+}
+
+auto Domain::_sole_owner() const -> bool
+{
+    if (_values.use_count() != 1)
+        return false;
+
+    // the last other owner may have let go from another thread, and
+    // everything it did with the values must happen before we change them
+    atomic_thread_fence(memory_order_acquire);
+    return true;
+}
+
+auto Domain::_unshare() -> set<VariableValue> &
+{
+    if (! _sole_owner())
+        _values = make_shared<set<VariableValue> >(*_values);
+    return *_values;
+}
+
+auto Domain::begin() const -> const_iterator
+{
+    return _values ? const_iterator{ _values->begin() } : const_iterator{ _bits };
+}
+
+auto Domain::end() const -> const_iterator
+{
+    return _values ? const_iterator{ _values->end() } : const_iterator{ uint64_t{ 0 } };
+}
+
+auto Domain::lower_bound(VariableValue v) const -> const_iterator
+{
+    return _values ? const_iterator{ _values->lower_bound(v) } : const_iterator{ _bits & bits_from(v) };
+}
+
+auto Domain::upper_bound(VariableValue v) const -> const_iterator
+{
+    return _values ? const_iterator{ _values->upper_bound(v) } : const_iterator{ _bits & bits_from(VariableValue{ int{ v } + 1 }) };
+}
+
+auto Domain::size() const -> size_t
+{
+    return _values ? _values->size() : __builtin_popcountll(_bits);
+}
+
+auto Domain::empty() const -> bool
+{
+    return _values ? _values->empty() : 0 == _bits;
+}
+
+auto Domain::count(VariableValue v) const -> size_t
+{
+    if (_values)
+        return _values->count(v);
+    return in_small_range(v) && (_bits & bit(v)) ? 1 : 0;
+}
+
+auto Domain::insert(VariableValue v) -> void
+{
+    if (! _values) {
+        if (in_small_range(v)) {
+            _bits |= bit(v);
+            return;
+        }
+
+        // this doesn't happen during search, so we don't mind it being slow
+        _values = make_shared<set<VariableValue> >(begin(), end());
+    }
+
+    if (! _values->count(v))
+        _unshare().insert(v);
+}
+
+auto Domain::erase(VariableValue v) -> size_t
+{
+    if (! _values) {
+        auto result = count(v);
+        if (result)
+            _bits &= ~bit(v);
+        return result;
+    }
+
+    // don't make a copy just to find out that there's nothing to remove
+    if (! _values->count(v))
+        return 0;
+    return _unshare().erase(v);
+}
+
+auto Domain::erase(const_iterator first, const_iterator last) -> void
+{
+    if (first == last)
+        return;
+
+    if (! _values) {
+        // everything from first up to but not including last
+        _bits &= ~(bits_from(*first) & ~(last == end() ? 0 : bits_from(*last)));
+        return;
+    }
+
+    // const_iterator doesn't let us get at the set iterators, so find them
+    // again by value
+    auto set_first = _values->lower_bound(*first);
+    auto set_last = last == end() ? _values->end() : _values->lower_bound(*last);
+
+    if (! _sole_owner()) {
+        // the iterators point into the shared values, so build our own copy
+        // without the range rather than copying everything and then erasing
+        auto values = make_shared<set<VariableValue> >(_values->begin(), set_first);
+        values->insert(set_last, _values->end());
+        _values = move(values);
+    }
+    else
+        _values->erase(set_first, set_last);
+}
+
+auto Domain::clear() -> void
+{
+    _values.reset();
+    _bits = 0;
+}
+
+auto Domain::small() const -> bool
+{
+    return ! _values;
+}
+
+auto Domain::bits() const -> uint64_t
+{
+    return _bits;
+}
@@ -0,0 +1,129 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+#ifndef CERTIFIED_CONSTRAINT_SOLVER_GUARD_SRC_DOMAIN_HH
+#define CERTIFIED_CONSTRAINT_SOLVER_GUARD_SRC_DOMAIN_HH 1
+
+#include "variable-fwd.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <set>
+
+/**
+ * The values a variable can still take. If every value is between 0 and 63,
+ * which covers things like sudoku cells and colours, the values are held as
+ * the bits of a single word. Otherwise, copies share a set of values until
+ * one of them is changed, so copying a model at a search node only copies
+ * the domains that then get changed, and a variable whose domain hasn't
+ * changed since it was created shares its values with every other variable
+ * created from the same original values.
+ */
+class Domain
+{
+    private:
+        // null if we are small
+        std::shared_ptr<std::set<VariableValue> > _values;
+        std::uint64_t _bits = 0;
+
+        auto _sole_owner() const -> bool;
+        auto _unshare() -> std::set<VariableValue> &;
+        auto _make_small_if_possible() -> void;
+
+    public:
+        static constexpr int small_limit = 64;
+
+        class const_iterator
+        {
+            private:
+                std::set<VariableValue>::const_iterator _set_iterator;
+                std::uint64_t _bits = 0;
+                VariableValue _value{ 0 };
+                bool _small = false;
+
+            public:
+                using iterator_category = std::forward_iterator_tag;
+                using value_type = VariableValue;
+                using difference_type = std::ptrdiff_t;
+                using pointer = const VariableValue *;
+                using reference = const VariableValue &;
+
+                const_iterator() = default;
+
+                explicit const_iterator(std::set<VariableValue>::const_iterator i) :
+                    _set_iterator(i)
+                {
+                }
+
+                explicit const_iterator(std::uint64_t bits) :
+                    _bits(bits),
+                    _value(bits ? __builtin_ctzll(bits) : 0),
+                    _small(true)
+                {
+                }
+
+                auto operator* () const -> reference
+                {
+                    return _small ? _value : *_set_iterator;
+                }
+
+                auto operator-> () const -> pointer
+                {
+                    return &**this;
+                }
+
+                auto operator++ () -> const_iterator &
+                {
+                    if (_small) {
+                        _bits &= _bits - 1;
+                        _value = VariableValue{ _bits ? __builtin_ctzll(_bits) : 0 };
+                    }
+                    else
+                        ++_set_iterator;
+                    return *this;
+                }
+
+                auto operator++ (int) -> const_iterator
+                {
+                    auto result = *this;
+                    ++*this;
+                    return result;
+                }
+
+                auto operator== (const const_iterator & other) const -> bool
+                {
+                    return _small ? _bits == other._bits : _set_iterator == other._set_iterator;
+                }
+
+                auto operator!= (const const_iterator & other) const -> bool
+                {
+                    return ! (*this == other);
+                }
+        };
+
+        explicit Domain(const std::shared_ptr<std::set<VariableValue> > &);
+        Domain(std::initializer_list<VariableValue>);
+
+        auto begin() const -> const_iterator;
+        auto end() const -> const_iterator;
+        auto lower_bound(VariableValue) const -> const_iterator;
+        auto upper_bound(VariableValue) const -> const_iterator;
+
+        auto size() const -> std::size_t;
+        auto empty() const -> bool;
+        auto count(VariableValue) const -> std::size_t;
+
+        auto insert(VariableValue) -> void;
+        auto erase(VariableValue) -> std::size_t;
+        auto erase(const_iterator first, const_iterator last) -> void;
+        auto clear() -> void;
+
+        // if every value is between 0 and small_limit - 1, bit v of bits()
+        // says whether we contain v
+        auto small() const -> bool;
+        auto bits() const -> std::uint64_t;
+};
+
+#endif
@@ -1,6 +1,7 @@
 /* vim: set sw=4 sts=4 et foldmethod=syntax : */
 
 #include "equals_constant_constraint.hh"
+#include "binary_model.hh"
 #include "model.hh"
 #include "variable.hh"
 #include "proof.hh"
@@ -9,6 +10,8 @@ using std::endl;
 using std::optional;
 using std::set;
 
+namespace pmr = std::pmr;
+
 EqualConstantConstraint::EqualConstantConstraint(VariableID a, VariableValue b) :
     _first(a),
     _second(b)
@@ -17,13 +20,13 @@ EqualConstantConstraint::EqualConstantConstraint(VariableID a, VariableValue b)
 
 EqualConstantConstraint::~EqualConstantConstraint() = default;
 
-auto EqualConstantConstraint::propagate(Model & model, optional<Proof> & proof, set<VariableID> & changed_vars) const -> bool
+auto EqualConstantConstraint::propagate(Model & model, optional<Proof> & proof, pmr::set<VariableID> & changed_vars) const -> bool
 {
     auto f = model.get_variable(_first);
 
     // either the variable doesn't contain the value at all...
     if (! f->values.count(_second)) {
-        if (proof)
+        if (proof && proof->comments(ProofComments::Full))
             proof->proof_stream() << "* got domain wipeout on equals" << endl;
         f->values.clear();
         return false;
@@ -60,3 +63,15 @@ auto EqualConstantConstraint::priority() const -> int
     return 0;
 }
 
+auto EqualConstantConstraint::write_binary(BinaryModelWriter & writer) const -> void
+{
+    writer.start_constraint(BinaryConstraintKind::EqualConstant);
+    writer.write_variables({ _first });
+    writer.write_int(int{ _second });
+}
+
+auto EqualConstantConstraint::entailed(const Model & model) const -> bool
+{
+    auto & values = model.get_variable(_first)->values;
+    return values.size() == 1 && *values.begin() == _second;
+}
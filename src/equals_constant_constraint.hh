@@ -5,7 +5,7 @@
 
 #include "constraint.hh"
 
-class EqualConstantConstraint : public Constraint
+class EqualConstantConstraint final : public Constraint
 {
     private:
         VariableID _first;
@@ -16,13 +16,17 @@ class EqualConstantConstraint : public Constraint
         EqualConstantConstraint(VariableID, VariableValue);
         virtual ~EqualConstantConstraint() override;
 
-        virtual auto propagate(Model & model, std::optional<Proof> &, std::set<VariableID> &) const -> bool override;
+        virtual auto propagate(Model & model, std::optional<Proof> &, std::pmr::set<VariableID> &) const -> bool override;
 
         virtual auto start_proof(const Model &, Proof &) -> void override;
 
         virtual auto associated_variables() const -> std::set<VariableID> override;
 
         virtual auto priority() const -> int override;
+
+        virtual auto write_binary(BinaryModelWriter &) const -> void override;
+
+        virtual auto entailed(const Model &) const -> bool override;
 };
 
 #endif
@@ -0,0 +1,27 @@
+TARGET := libcertified_constraint_solver.a
+
+SOURCES := \
+    all_different_constraint.cc \
+    batch.cc \
+    binary_model.cc \
+    components.cc \
+    constraint.cc \
+    cubes.cc \
+    domain.cc \
+    mapped_file.cc \
+    model.cc \
+    not_equals_constraint.cc \
+    equals_constant_constraint.cc \
+    parallel_search.cc \
+    presolve.cc \
+    probing.cc \
+    proof.cc \
+    proof_writer.cc \
+    read_model.cc \
+    result.cc \
+    scratch.cc \
+    search.cc \
+    solve.cc \
+    solver.cc \
+    table_constraint.cc \
+    variable.cc
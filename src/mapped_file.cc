@@ -0,0 +1,98 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+#include "mapped_file.hh"
+#include "read_model.hh"
+
+#include <cerrno>
+#include <map>
+#include <mutex>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using std::make_shared;
+using std::map;
+using std::mutex;
+using std::shared_ptr;
+using std::string;
+using std::string_view;
+using std::unique_lock;
+using std::weak_ptr;
+
+MappedFile::MappedFile(const string & filename)
+{
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (-1 == fd)
+        throw InputError{ "Error reading from '" + filename + "'" };
+
+    struct stat st;
+    if (-1 == ::fstat(fd, &st)) {
+        ::close(fd);
+        throw InputError{ "Error reading from '" + filename + "'" };
+    }
+
+    // a pipe, FIFO or terminal reports a size of zero and can't be mapped, so
+    // read whatever it gives us until end of file
+    if (! S_ISREG(st.st_mode)) {
+        char buffer[1 << 16];
+        while (true) {
+            auto got = ::read(fd, buffer, sizeof(buffer));
+            if (-1 == got && EINTR == errno)
+                continue;
+            if (-1 == got) {
+                ::close(fd);
+                throw InputError{ "Error reading from '" + filename + "'" };
+            }
+            if (0 == got)
+                break;
+            _read.append(buffer, got);
+        }
+
+        ::close(fd);
+        _size = _read.size();
+        return;
+    }
+
+    // mapping an empty file fails, but there's nothing to map anyway
+    _size = st.st_size;
+    if (0 != _size) {
+        void * mapped = ::mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (MAP_FAILED == mapped) {
+            ::close(fd);
+            throw InputError{ "Error mapping '" + filename + "'" };
+        }
+        _data = static_cast<const char *>(mapped);
+    }
+
+    // the mapping stays valid after the descriptor is closed
+    ::close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+    if (_data)
+        ::munmap(const_cast<char *>(_data), _size);
+}
+
+auto MappedFile::contents() const -> string_view
+{
+    return _data ? string_view{ _data, _size } : string_view{ _read };
+}
+
+auto shared_mapping(const string & filename) -> shared_ptr<const MappedFile>
+{
+    static mutex mappings_mutex;
+    static map<string, weak_ptr<const MappedFile> > mappings;
+
+    unique_lock<mutex> guard{ mappings_mutex };
+    auto & existing = mappings[filename];
+    auto result = existing.lock();
+    if (! result) {
+        result = make_shared<const MappedFile>(filename);
+        existing = result;
+    }
+
+    return result;
+}
@@ -0,0 +1,40 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+#ifndef CERTIFIED_CONSTRAINT_SOLVER_GUARD_SRC_MAPPED_FILE_HH
+#define CERTIFIED_CONSTRAINT_SOLVER_GUARD_SRC_MAPPED_FILE_HH 1
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+
+/**
+ * A read-only memory mapping of an entire file, which stays valid for as long
+ * as this object does. Pipes and other files that cannot be mapped are read
+ * into memory instead. Throws InputError if the file cannot be read.
+ */
+class MappedFile
+{
+    private:
+        const char * _data = nullptr;
+        std::size_t _size = 0;
+        std::string _read;
+
+    public:
+        explicit MappedFile(const std::string & filename);
+        MappedFile(const MappedFile &) = delete;
+        ~MappedFile();
+
+        auto operator= (const MappedFile &) -> MappedFile & = delete;
+
+        auto contents() const -> std::string_view;
+};
+
+/**
+ * Map a file, or reuse an existing mapping of the same file if anything in
+ * this process still holds one, so that threads reading the same large file
+ * share a single copy.
+ */
+auto shared_mapping(const std::string & filename) -> std::shared_ptr<const MappedFile>;
+
+#endif
@@ -3,27 +3,51 @@
 #include "model.hh"
 #include "variable.hh"
 #include "constraint.hh"
+#include "all_different_constraint.hh"
+#include "equals_constant_constraint.hh"
+#include "not_equals_constraint.hh"
+#include "table_constraint.hh"
 #include "result.hh"
 #include "proof.hh"
 #include "queue_set.hh"
+#include "scratch.hh"
 
+#include <algorithm>
+#include <charconv>
 #include <iomanip>
+#include <iterator>
 #include <map>
 #include <memory>
+#include <memory_resource>
+#include <set>
+#include <string_view>
+#include <system_error>
 #include <utility>
+#include <vector>
 
+using std::distance;
+using std::errc;
+using std::from_chars;
 using std::endl;
+using std::function;
+using std::less;
 using std::list;
 using std::make_shared;
 using std::make_unique;
 using std::map;
+using std::max;
 using std::multimap;
+using std::nullopt;
 using std::optional;
 using std::pair;
 using std::shared_ptr;
 using std::set;
 using std::string;
+using std::string_view;
 using std::to_string;
+using std::vector;
+
+namespace pmr = std::pmr;
 
 ModelError::ModelError(const string & m) noexcept :
     _message("Model error: " + m)
@@ -35,22 +59,115 @@ auto ModelError::what() const noexcept -> const char *
     return _message.c_str();
 }
 
+namespace
+{
+struct VariableArray
+{
+    string name;
+    vector<pair<int, int> > index_ranges;
+    long long size;
+};
+
+// names for arrays are only worked out when someone asks for them, since
+// there can be a lot of them
+struct VariableNames
+{
+    map<string, VariableID, less<> > name_to_variable_id;
+    map<VariableID, string> variable_id_to_name;
+    map<VariableID, VariableArray> arrays_by_first_variable;
+    map<string, VariableID, less<> > array_name_to_first_variable;
+};
+
+// the constraints we know about get propagated without going through a
+// virtual call
+enum class PropagatorKind
+{
+    EqualConstant,
+    NotEqual,
+    AllDifferent,
+    Table,
+    Other
+};
+
+// everything propagation needs, worked out once and then shared between
+// copies of the model. constraints are referred to by their position in
+// the list.
+struct PropagationIndex
+{
+    // keeps the constraints we point to alive
+    shared_ptr<list<shared_ptr<Constraint> > > constraints;
+
+    vector<const Constraint *> handles;
+    vector<PropagatorKind> kinds;
+    vector<unsigned> priorities;
+    unsigned number_of_priorities = 0;
+
+    // the constraints on variable v are watching[watching_start[v]] up to
+    // watching[watching_start[v + 1]]
+    vector<unsigned> watching_start;
+    vector<unsigned> watching;
+};
+}
+
 struct Model::Imp
 {
     map<VariableID, shared_ptr<Variable> > vars;
+
+    // the elements of each array live next to each other, indexed from the
+    // first variable, so that copying a model copies an array as one block
+    map<VariableID, shared_ptr<vector<Variable> > > arrays;
+
+    // fixed variables that no constraint cares about, which presolve moves
+    // out of the way so that search doesn't copy them at every node
+    shared_ptr<const map<VariableID, shared_ptr<Variable> > > eliminated_vars;
+
     shared_ptr<list<shared_ptr<Constraint> > > constraints;
     shared_ptr<multimap<VariableID, shared_ptr<Constraint> > > constraints_associated_with;
-    shared_ptr<map<string, VariableID> > name_to_variable_id;
-    shared_ptr<map<VariableID, string> > variable_id_to_name;
+    shared_ptr<const PropagationIndex> propagation_index;
+    shared_ptr<VariableNames> names;
+    optional<pair<VariableID, ObjectiveDirection> > objective;
+    optional<AllDifferentStrength> all_different_strength;
+
+    auto find_array(VariableID) const -> map<VariableID, shared_ptr<vector<Variable> > >::const_iterator;
+
+    // every variable search looks at, in order, until the function says to stop
+    template <typename F_>
+    auto for_each_searched_variable(const F_ &) const -> void;
 };
 
+auto Model::Imp::find_array(VariableID v) const -> map<VariableID, shared_ptr<vector<Variable> > >::const_iterator
+{
+    auto a = arrays.upper_bound(v);
+    if (a == arrays.begin())
+        return arrays.end();
+    --a;
+    return (int{ v } - int{ a->first } < int(a->second->size())) ? a : arrays.end();
+}
+
+template <typename F_>
+auto Model::Imp::for_each_searched_variable(const F_ & f) const -> void
+{
+    auto v = vars.begin();
+    for (auto & [ first, elements ] : arrays) {
+        for ( ; v != vars.end() && v->first < first ; ++v)
+            if (! f(v->first, *v->second))
+                return;
+        for (unsigned i = 0 ; i < elements->size() ; ++i)
+            if (! f(VariableID{ int(int{ first } + i) }, (*elements)[i]))
+                return;
+    }
+
+    for ( ; v != vars.end() ; ++v)
+        if (! f(v->first, *v->second))
+            return;
+}
+
 Model::Model() :
     _imp(make_unique<Model::Imp>())
 {
     _imp->constraints = make_shared<list<shared_ptr<Constraint> > >();
     _imp->constraints_associated_with = make_shared<multimap<VariableID, shared_ptr<Constraint> > >();
-    _imp->name_to_variable_id = make_shared<map<string, VariableID> >();
-    _imp->variable_id_to_name = make_shared<map<VariableID, string> >();
+    _imp->names = make_shared<VariableNames>();
 }
 
 Model::Model(const Model & other) :
@@ -59,60 +176,223 @@ Model::Model(const Model & other) :
     _imp->constraints = other._imp->constraints;
     for (auto & [ n, v ] : other._imp->vars)
         _imp->vars.emplace(n, make_shared<Variable>(*v));
+    for (auto & [ first, elements ] : other._imp->arrays)
+        _imp->arrays.emplace(first, make_shared<vector<Variable> >(*elements));
+    _imp->eliminated_vars = other._imp->eliminated_vars;
     _imp->constraints_associated_with = other._imp->constraints_associated_with;
-    _imp->name_to_variable_id = other._imp->name_to_variable_id;
-    _imp->variable_id_to_name = other._imp->variable_id_to_name;
+    _imp->propagation_index = other._imp->propagation_index;
+    _imp->names = other._imp->names;
+    _imp->objective = other._imp->objective;
+    _imp->all_different_strength = other._imp->all_different_strength;
 }
 
 Model::~Model() = default;
 
 auto Model::add_variable(const std::string & name, VariableID n, shared_ptr<Variable> v) -> bool
 {
-    if (_imp->vars.emplace(n, v).second) {
-        _imp->name_to_variable_id->emplace(name, n);
-        _imp->variable_id_to_name->emplace(n, name);
+    if (_imp->find_array(n) == _imp->arrays.end() && _imp->vars.emplace(n, v).second) {
+        _imp->names->name_to_variable_id.emplace(name, n);
+        _imp->names->variable_id_to_name.emplace(n, name);
         return true;
     }
 
     return false;
 }
 
+auto Model::add_variable_array(const string & name, VariableID first, const vector<pair<int, int> > & index_ranges,
+        const Variable & prototype) -> bool
+{
+    long long size = 1;
+    for (auto & [ lower, upper ] : index_ranges)
+        size *= (upper >= lower ? upper - lower + 1 : 0);
+
+    if (! _imp->names->array_name_to_first_variable.emplace(name, first).second)
+        return false;
+    _imp->names->arrays_by_first_variable.emplace(first, VariableArray{ name, index_ranges, size });
+
+    if (0 == size)
+        return true;
+
+    // nothing else may use any of the identifiers we are about to take
+    auto last = VariableID{ int(int{ first } + size - 1) };
+    auto v = _imp->vars.lower_bound(first);
+    auto a = _imp->arrays.lower_bound(first);
+    if ((v != _imp->vars.end() && v->first <= last) || (a != _imp->arrays.end() && a->first <= last)
+            || _imp->find_array(first) != _imp->arrays.end())
+        return false;
+
+    // every element shares the prototype's original values
+    _imp->arrays.emplace(first, make_shared<vector<Variable> >(size, prototype));
+    return true;
+}
+
+auto Model::for_each_variable_array(const function<auto (const string &, VariableID, const vector<pair<int, int> > &) -> void> & f) const -> void
+{
+    for (auto & [ first, array ] : _imp->names->arrays_by_first_variable)
+        f(array.name, first, array.index_ranges);
+}
+
 auto Model::get_variable(VariableID n) const -> shared_ptr<Variable>
 {
     auto r = _imp->vars.find(n);
-    if (r == _imp->vars.end())
-        throw ModelError{ "Missing variable" };
-    else
+    if (r != _imp->vars.end())
         return r->second;
+
+    // array elements are kept alive by their array
+    auto a = _imp->find_array(n);
+    if (a != _imp->arrays.end())
+        return shared_ptr<Variable>{ a->second, &(*a->second)[int{ n } - int{ a->first }] };
+
+    if (_imp->eliminated_vars) {
+        auto e = _imp->eliminated_vars->find(n);
+        if (e != _imp->eliminated_vars->end())
+            return e->second;
+    }
+
+    throw ModelError{ "Missing variable" };
 }
 
-auto Model::select_branch_variable() const -> pair<VariableID, shared_ptr<Variable> >
+auto Model::find_variable(string_view name) const -> optional<VariableID>
 {
-    pair<VariableID, shared_ptr<Variable> > result;
-    for (auto & [ name, v ] : _imp->vars) {
-        if (v->values.size() != 1) {
-            if ((! result.second) || v->values.size() < result.second->values.size()) {
-                result = pair{ name, v };
-            }
-        }
+    auto r = _imp->names->name_to_variable_id.find(name);
+    if (r != _imp->names->name_to_variable_id.end())
+        return r->second;
+
+    // otherwise it might be an array element, like x[1,2]
+    auto open = name.find('[');
+    if (string_view::npos == open || name.back() != ']')
+        return nullopt;
+
+    auto a = _imp->names->array_name_to_first_variable.find(name.substr(0, open));
+    if (a == _imp->names->array_name_to_first_variable.end())
+        return nullopt;
+    auto & array = _imp->names->arrays_by_first_variable.find(a->second)->second;
+
+    auto indices = name.substr(open + 1, name.size() - open - 2);
+    auto & ranges = array.index_ranges;
+    long long offset = 0;
+    for (unsigned d = 0 ; d < ranges.size() ; ++d) {
+        // there should be a comma after every index apart from the last
+        auto comma = indices.find(',');
+        if ((string_view::npos == comma) != (d + 1 == ranges.size()))
+            return nullopt;
+
+        int index;
+        auto index_string = indices.substr(0, comma);
+        auto [ end, ec ] = from_chars(index_string.data(), index_string.data() + index_string.size(), index);
+        if (ec != errc{ } || end != index_string.data() + index_string.size() || index < ranges[d].first || index > ranges[d].second)
+            return nullopt;
+
+        offset = offset * (ranges[d].second - ranges[d].first + 1) + (index - ranges[d].first);
+        indices.remove_prefix(string_view::npos == comma ? indices.size() : comma + 1);
     }
 
-    return result;
+    return VariableID{ int(int{ a->second } + offset) };
 }
 
-auto Model::save_result(Result & result) const -> void
+auto Model::for_each_variable(const function<auto (VariableID, const Variable &) -> void> & f) const -> void
 {
-    for (auto & [ name, v ] : _imp->vars) {
-        if (1 != v->values.size())
-            throw ModelError{ "Don't have a unique value for a variable" };
-        result.solution.emplace(_imp->variable_id_to_name->find(name)->second, to_string(int{ *v->values.begin() }));
+    if (! _imp->eliminated_vars) {
+        _imp->for_each_searched_variable([&] (VariableID name, const Variable & v) {
+                f(name, v);
+                return true;
+                });
+        return;
     }
+
+    // merge in any eliminated variables, so everything still comes out in order
+    auto e = _imp->eliminated_vars->begin();
+    _imp->for_each_searched_variable([&] (VariableID name, const Variable & v) {
+            for ( ; e != _imp->eliminated_vars->end() && e->first < name ; ++e)
+                f(e->first, *e->second);
+            f(name, v);
+            return true;
+            });
+    for ( ; e != _imp->eliminated_vars->end() ; ++e)
+        f(e->first, *e->second);
+}
+
+auto Model::for_each_constraint(const function<auto (const Constraint &) -> void> & f) const -> void
+{
+    for (auto & c : *_imp->constraints)
+        f(*c);
+}
+
+auto Model::select_branch_variable(VariableOrdering ordering) const -> pair<VariableID, shared_ptr<Variable> >
+{
+    optional<VariableID> result;
+    const Variable * result_variable = nullptr;
+    unsigned long long result_degree = 0;
+    _imp->for_each_searched_variable([&] (VariableID name, const Variable & v) {
+            if (v.values.size() != 1) {
+                switch (ordering) {
+                    case VariableOrdering::SmallestDomain:
+                        if ((! result_variable) || v.values.size() < result_variable->values.size()) {
+                            result = name;
+                            result_variable = &v;
+                        }
+                        break;
+
+                    case VariableOrdering::DomainOverDegree: {
+                        // compare size / degree without dividing, so that a
+                        // variable in no constraints goes last
+                        unsigned long long degree = _imp->constraints_associated_with->count(name);
+                        if ((! result_variable) || v.values.size() * result_degree < result_variable->values.size() * degree) {
+                            result = name;
+                            result_variable = &v;
+                            result_degree = degree;
+                        }
+                        break;
+                    }
+
+                    case VariableOrdering::InputOrder:
+                        result = name;
+                        return false;
+                }
+            }
+            return true;
+            });
+
+    if (! result)
+        return pair<VariableID, shared_ptr<Variable> >{ };
+    return pair{ *result, get_variable(*result) };
+}
+
+auto Model::save_result(Result & result) const -> void
+{
+    for_each_variable([&] (VariableID name, const Variable & v) {
+            if (1 != v.values.size())
+                throw ModelError{ "Don't have a unique value for a variable" };
+            result.solution.emplace(original_name(name), to_string(int{ *v.values.begin() }));
+            result.values.emplace(name, *v.values.begin());
+            });
 }
 
 auto Model::start_proof(Proof & proof) const -> void
 {
-    for (auto & [ name, v ] : _imp->vars)
-        v->start_proof(*this, name, proof);
+    _imp->for_each_searched_variable([&] (VariableID name, const Variable & v) {
+            v.start_proof(*this, name, proof);
+            return true;
+            });
+    if (_imp->eliminated_vars)
+        for (auto & [ name, v ] : *_imp->eliminated_vars)
+            v->start_proof(*this, name, proof);
+
+    if (_imp->objective) {
+        // pseudo-Boolean objectives always minimise, and we shift the values so
+        // that every coefficient is non-negative, which keeps the objective
+        // improving constraints nice and propagating
+        auto & [ var, direction ] = *_imp->objective;
+        auto & values = *get_variable(var)->original_values;
+        proof.objective_stream() << "min:";
+        for (auto & v : values) {
+            int coeff = (direction == ObjectiveDirection::Minimize) ?
+                int{ v } - int{ *values.begin() } : int{ *values.rbegin() } - int{ v };
+            if (0 != coeff)
+                proof.objective_stream() << " " << coeff << " x" << proof.variable_value_mapping(var, v);
+        }
+        proof.objective_stream() << " ;" << endl;
+    }
 
     for (auto & c : *_imp->constraints)
         c->start_proof(*this, proof);
@@ -126,40 +406,283 @@ auto Model::add_constraint(shared_ptr<Constraint> c) -> void
     _imp->constraints->push_back(c);
     for (auto & v : c->associated_variables())
         _imp->constraints_associated_with->emplace(v, c);
+    _imp->propagation_index.reset();
+}
+
+auto Model::remove_constraints_if(const function<auto (const Constraint &) -> bool> & f) -> unsigned long long
+{
+    // the constraints are shared with other copies of the model, so we build
+    // new lists rather than changing the old ones
+    auto constraints = make_shared<list<shared_ptr<Constraint> > >();
+    auto constraints_associated_with = make_shared<multimap<VariableID, shared_ptr<Constraint> > >();
+    unsigned long long removed = 0;
+    for (auto & c : *_imp->constraints) {
+        if (f(*c))
+            ++removed;
+        else {
+            constraints->push_back(c);
+            for (auto & v : c->associated_variables())
+                constraints_associated_with->emplace(v, c);
+        }
+    }
+
+    _imp->constraints = constraints;
+    _imp->constraints_associated_with = constraints_associated_with;
+    _imp->propagation_index.reset();
+    return removed;
+}
+
+auto Model::eliminate_fixed_variables() -> unsigned long long
+{
+    auto eliminated_vars = make_shared<map<VariableID, shared_ptr<Variable> > >();
+    if (_imp->eliminated_vars)
+        *eliminated_vars = *_imp->eliminated_vars;
+
+    unsigned long long eliminated = 0;
+    for (auto v = _imp->vars.begin() ; v != _imp->vars.end() ; ) {
+        if (v->second->values.size() == 1 && ! _imp->constraints_associated_with->count(v->first)
+                && ! (_imp->objective && _imp->objective->first == v->first)) {
+            eliminated_vars->insert(*v);
+            v = _imp->vars.erase(v);
+            ++eliminated;
+        }
+        else
+            ++v;
+    }
+
+    _imp->eliminated_vars = eliminated_vars;
+    return eliminated;
+}
+
+auto Model::set_objective(VariableID v, ObjectiveDirection d) -> void
+{
+    _imp->objective = pair{ v, d };
+}
+
+auto Model::objective() const -> optional<pair<VariableID, ObjectiveDirection> >
+{
+    return _imp->objective;
+}
+
+auto Model::override_all_different_strength(AllDifferentStrength s) -> void
+{
+    _imp->all_different_strength = s;
+}
+
+auto Model::all_different_strength_override() const -> optional<AllDifferentStrength>
+{
+    return _imp->all_different_strength;
+}
+
+namespace
+{
+auto build_propagation_index(const shared_ptr<list<shared_ptr<Constraint> > > & constraints) -> shared_ptr<const PropagationIndex>
+{
+    auto index = make_shared<PropagationIndex>();
+    index->constraints = constraints;
+
+    vector<pair<int, unsigned> > watches;
+    int largest_variable = -1;
+    for (auto & c : *constraints) {
+        unsigned handle = index->handles.size();
+        index->handles.push_back(c.get());
+
+        if (dynamic_cast<const EqualConstantConstraint *>(c.get()))
+            index->kinds.push_back(PropagatorKind::EqualConstant);
+        else if (dynamic_cast<const NotEqualConstraint *>(c.get()))
+            index->kinds.push_back(PropagatorKind::NotEqual);
+        else if (dynamic_cast<const AllDifferentConstraint *>(c.get()))
+            index->kinds.push_back(PropagatorKind::AllDifferent);
+        else if (dynamic_cast<const TableConstraint *>(c.get()))
+            index->kinds.push_back(PropagatorKind::Table);
+        else
+            index->kinds.push_back(PropagatorKind::Other);
+
+        if (c->priority() < 0)
+            throw ModelError{ "Constraint has a negative priority" };
+        index->priorities.push_back(c->priority());
+        index->number_of_priorities = max(index->number_of_priorities, unsigned(c->priority()) + 1);
+
+        for (auto & v : c->associated_variables()) {
+            if (int{ v } < 0)
+                throw ModelError{ "Constraint on a variable with a negative identifier" };
+            watches.emplace_back(int{ v }, handle);
+            largest_variable = max(largest_variable, int{ v });
+        }
+    }
+
+    // counting sort the watches by variable
+    index->watching_start.assign(largest_variable + 2, 0);
+    for (auto & [ v, _ ] : watches)
+        ++index->watching_start[v + 1];
+    for (unsigned v = 1 ; v < index->watching_start.size() ; ++v)
+        index->watching_start[v] += index->watching_start[v - 1];
+
+    index->watching.resize(watches.size());
+    auto next = index->watching_start;
+    for (auto & [ v, handle ] : watches)
+        index->watching[next[v]++] = handle;
+
+    return index;
+}
+
+auto propagate_one(const PropagationIndex & index, unsigned handle, Model & model, optional<Proof> & proof,
+        pmr::set<VariableID> & changed_variables) -> bool
+{
+    // the casts are to classes which are final, so these aren't virtual calls
+    auto c = index.handles[handle];
+    switch (index.kinds[handle]) {
+        case PropagatorKind::EqualConstant:
+            return static_cast<const EqualConstantConstraint *>(c)->propagate(model, proof, changed_variables);
+        case PropagatorKind::NotEqual:
+            return static_cast<const NotEqualConstraint *>(c)->propagate(model, proof, changed_variables);
+        case PropagatorKind::AllDifferent:
+            return static_cast<const AllDifferentConstraint *>(c)->propagate(model, proof, changed_variables);
+        case PropagatorKind::Table:
+            return static_cast<const TableConstraint *>(c)->propagate(model, proof, changed_variables);
+        case PropagatorKind::Other:
+            break;
+    }
+
+    return c->propagate(model, proof, changed_variables);
+}
 }
 
 auto Model::propagate(optional<Proof> & proof) -> bool
 {
-    QueueSet<pair<int, shared_ptr<Constraint> > > q;
+    if (! _imp->propagation_index)
+        _imp->propagation_index = build_propagation_index(_imp->constraints);
+    auto & index = *_imp->propagation_index;
+
+    // the queue hands out everything of one priority, such as all the cheap
+    // not equals constraints, before moving on to anything more expensive.
+    // the queue and the changed variables reuse this thread's pool, so once
+    // it has seen the biggest model, propagating doesn't touch the heap.
+    QueueSet q{ unsigned(index.handles.size()), index.number_of_priorities, scratch_pool() };
 
     // initially we have to revise every constraint
-    for (auto & c : *_imp->constraints)
-        q.enqueue(pair{ c->priority(), c });
+    for (unsigned c = 0 ; c < index.handles.size() ; ++c)
+        q.enqueue(c, index.priorities[c]);
 
     // until we reach a fixed point...
+    pmr::set<VariableID> changed_variables{ scratch_pool() };
     while (! q.empty()) {
         // get us a constraint to revise
-        auto [ _, c ] = q.dequeue();
+        auto c = q.dequeue();
 
-        set<VariableID> changed_variables;
-        if (! c->propagate(*this, proof, changed_variables))
+        changed_variables.clear();
+        if (! propagate_one(index, c, *this, proof, changed_variables))
             return false;
 
-        // look at every changed variable, and requeue constraints other than c
-        // involving those variables. note that requeueing a constraint that is
-        // already on the queue does nothing.
-        for (auto & v : changed_variables) {
-            auto to_requeue = _imp->constraints_associated_with->equal_range(v);
-            for (auto d = to_requeue.first ; d != to_requeue.second ; ++d)
-                q.enqueue(pair{ d->second->priority(), d->second });
-        }
+        // look at every changed variable, and requeue constraints involving
+        // those variables. note that requeueing a constraint that is already
+        // on the queue does nothing.
+        for (auto & v : changed_variables)
+            if (unsigned(int{ v }) + 1 < index.watching_start.size())
+                for (auto w = index.watching_start[int{ v }], w_end = index.watching_start[int{ v } + 1] ; w != w_end ; ++w)
+                    q.enqueue(index.watching[w], index.priorities[index.watching[w]]);
     }
 
     return true;
 }
 
+namespace
+{
+auto find_representative(map<VariableID, VariableID> & parents, VariableID v) -> VariableID
+{
+    while (parents.find(v)->second != v) {
+        auto & parent = parents.find(v)->second;
+        parent = parents.find(parent)->second;
+        v = parent;
+    }
+
+    return v;
+}
+}
+
+auto Model::independent_components() const -> vector<Model>
+{
+    // union-find over the unfixed variables, joining anything that shares a
+    // constraint. fixed variables don't connect anything.
+    map<VariableID, VariableID> parents;
+    _imp->for_each_searched_variable([&] (VariableID name, const Variable & v) {
+            if (v.values.size() != 1)
+                parents.emplace(name, name);
+            return true;
+            });
+
+    for (auto & c : *_imp->constraints) {
+        optional<VariableID> first;
+        for (auto & v : c->associated_variables())
+            if (parents.count(v)) {
+                if (! first)
+                    first = find_representative(parents, v);
+                else
+                    parents.find(find_representative(parents, v))->second = *first;
+            }
+    }
+
+    map<VariableID, vector<VariableID> > groups;
+    for (auto & [ name, _ ] : parents)
+        groups[find_representative(parents, name)].push_back(name);
+
+    vector<Model> result;
+    for (auto & [ _, group ] : groups) {
+        Model & component = result.emplace_back();
+        component._imp->names = _imp->names;
+        for (auto & v : group)
+            component._imp->vars.emplace(v, make_shared<Variable>(*get_variable(v)));
+
+        if (_imp->objective && component._imp->vars.count(_imp->objective->first))
+            component._imp->objective = _imp->objective;
+        component._imp->all_different_strength = _imp->all_different_strength;
+    }
+
+    // every constraint on an unfixed variable goes with that variable, and
+    // brings along the fixed variables it also needs
+    for (auto & c : *_imp->constraints) {
+        auto associated_variables = c->associated_variables();
+        for (auto & v : associated_variables)
+            if (parents.count(v)) {
+                auto representative = find_representative(parents, v);
+                auto & component = result[distance(groups.begin(), groups.find(representative))];
+                component.add_constraint(c);
+                for (auto & w : associated_variables)
+                    if (! component._imp->vars.count(w))
+                        component._imp->vars.emplace(w, make_shared<Variable>(*get_variable(w)));
+                break;
+            }
+    }
+
+    return result;
+}
+
 auto Model::original_name(VariableID v) const -> std::string
 {
-    return _imp->variable_id_to_name->find(v)->second;
+    auto r = _imp->names->variable_id_to_name.find(v);
+    if (r != _imp->names->variable_id_to_name.end())
+        return r->second;
+
+    auto a = _imp->names->arrays_by_first_variable.upper_bound(v);
+    if (a != _imp->names->arrays_by_first_variable.begin()) {
+        --a;
+        long long offset = int{ v } - int{ a->first };
+        if (offset < a->second.size) {
+            auto & ranges = a->second.index_ranges;
+            vector<int> indices(ranges.size());
+            for (auto i = ranges.size() ; i > 0 ; --i) {
+                long long extent = ranges[i - 1].second - ranges[i - 1].first + 1;
+                indices[i - 1] = ranges[i - 1].first + offset % extent;
+                offset /= extent;
+            }
+
+            string result = a->second.name + "[";
+            for (unsigned i = 0 ; i < indices.size() ; ++i)
+                result += (i == 0 ? "" : ",") + to_string(indices[i]);
+            return result + "]";
+        }
+    }
+
+    throw ModelError{ "Missing variable" };
 }
 
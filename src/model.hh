@@ -10,11 +10,15 @@
 #include "proof-fwd.hh"
 
 #include <exception>
+#include <functional>
 #include <list>
 #include <map>
 #include <memory>
 #include <optional>
 #include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 class ModelError : public std::exception
 {
@@ -27,6 +31,19 @@ class ModelError : public std::exception
         virtual auto what() const noexcept -> const char *;
 };
 
+enum class ObjectiveDirection
+{
+    Minimize,
+    Maximize
+};
+
+enum class VariableOrdering
+{
+    SmallestDomain,
+    DomainOverDegree,
+    InputOrder
+};
+
 class Model
 {
     private:
@@ -39,10 +56,30 @@ class Model
         ~Model();
 
         [[ nodiscard ]] auto add_variable(const std::string &, VariableID, std::shared_ptr<Variable>) -> bool;
+
+        // add an array of variables, each a copy of the prototype, numbered
+        // consecutively from first in row-major order, and stored together.
+        // elements are named like x[1,2], but only when something asks for
+        // their names.
+        [[ nodiscard ]] auto add_variable_array(const std::string &, VariableID first,
+                const std::vector<std::pair<int, int> > & index_ranges, const Variable & prototype) -> bool;
         auto add_constraint(std::shared_ptr<Constraint>) -> void;
 
+        auto set_objective(VariableID, ObjectiveDirection) -> void;
+        auto objective() const -> std::optional<std::pair<VariableID, ObjectiveDirection> >;
+
+        // propagate every all-different constraint in this copy of the model
+        // at the given strength, rather than the one it was created with
+        auto override_all_different_strength(AllDifferentStrength) -> void;
+        auto all_different_strength_override() const -> std::optional<AllDifferentStrength>;
+
         auto get_variable(VariableID) const -> std::shared_ptr<Variable>;
-        auto select_branch_variable() const -> std::pair<VariableID, std::shared_ptr<Variable> >;
+        auto find_variable(std::string_view) const -> std::optional<VariableID>;
+        auto for_each_variable(const std::function<auto (VariableID, const Variable &) -> void> &) const -> void;
+        auto for_each_variable_array(const std::function<auto (const std::string &, VariableID,
+                    const std::vector<std::pair<int, int> > &) -> void> &) const -> void;
+        auto for_each_constraint(const std::function<auto (const Constraint &) -> void> &) const -> void;
+        auto select_branch_variable(VariableOrdering = VariableOrdering::SmallestDomain) const -> std::pair<VariableID, std::shared_ptr<Variable> >;
         auto original_name(VariableID) const -> std::string;
 
         auto save_result(Result &) const -> void;
@@ -50,6 +87,20 @@ class Model
         auto start_proof(Proof &) const -> void;
 
         [[ nodiscard ]] auto propagate(std::optional<Proof> &) -> bool;
+
+        // forget every constraint for which the function returns true, in
+        // this copy of the model only, and say how many went
+        auto remove_constraints_if(const std::function<auto (const Constraint &) -> bool> &) -> unsigned long long;
+
+        // stop search from looking at fixed variables which are in no
+        // constraints. they still appear in for_each_variable and solutions.
+        // array elements stay with their array, which is copied as one block.
+        auto eliminate_fixed_variables() -> unsigned long long;
+
+        // split up the variables that are not yet fixed into groups that share
+        // no constraints, and give a model for each group, containing the
+        // constraints and fixed variables needed to propagate it
+        auto independent_components() const -> std::vector<Model>;
 };
 
 #endif
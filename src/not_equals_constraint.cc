@@ -1,6 +1,8 @@
 /* vim: set sw=4 sts=4 et foldmethod=syntax : */
 
 #include "not_equals_constraint.hh"
+#include "all_different_constraint.hh"
+#include "binary_model.hh"
 #include "model.hh"
 #include "variable.hh"
 #include "proof.hh"
@@ -14,6 +16,8 @@ using std::optional;
 using std::set;
 using std::string;
 
+namespace pmr = std::pmr;
+
 NotEqualConstraint::NotEqualConstraint(VariableID a, VariableID b) :
     _first(a),
     _second(b)
@@ -24,7 +28,7 @@ NotEqualConstraint::NotEqualConstraint(VariableID a, VariableID b) :
 
 NotEqualConstraint::~NotEqualConstraint() = default;
 
-auto NotEqualConstraint::propagate(Model & model, optional<Proof> & proof, set<VariableID> & changed_vars) const -> bool
+auto NotEqualConstraint::propagate(Model & model, optional<Proof> & proof, pmr::set<VariableID> & changed_vars) const -> bool
 {
     bool changed = false;
 
@@ -46,7 +50,7 @@ auto NotEqualConstraint::propagate(Model & model, optional<Proof> & proof, set<V
     half_propagate(*s, _second, *f, _first);
 
     if (changed && (f->values.empty() || s->values.empty())) {
-        if (proof)
+        if (proof && proof->comments(ProofComments::Full))
             proof->proof_stream() << "* got domain wipeout on not_equals" << endl;
         return false;
     }
@@ -80,3 +84,25 @@ auto NotEqualConstraint::priority() const -> int
     return 1;
 }
 
+auto NotEqualConstraint::write_binary(BinaryModelWriter & writer) const -> void
+{
+    writer.start_constraint(BinaryConstraintKind::NotEqual);
+    writer.write_variables({ _first, _second });
+}
+
+auto NotEqualConstraint::entailed(const Model & model) const -> bool
+{
+    auto & f = model.get_variable(_first)->values;
+    auto & s = model.get_variable(_second)->values;
+    for (auto & v : f)
+        if (s.count(v))
+            return false;
+    return true;
+}
+
+auto NotEqualConstraint::all_different_strength(const Model &) const -> optional<AllDifferentStrength>
+{
+    // removing the value of a fixed variable from the other is as good as it
+    // gets for two variables
+    return AllDifferentStrength::GAC;
+}
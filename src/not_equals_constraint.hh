@@ -8,7 +8,7 @@
 #include <map>
 #include <string>
 
-class NotEqualConstraint : public Constraint
+class NotEqualConstraint final : public Constraint
 {
     private:
         VariableID _first, _second;
@@ -18,13 +18,19 @@ class NotEqualConstraint : public Constraint
         NotEqualConstraint(VariableID, VariableID);
         virtual ~NotEqualConstraint() override;
 
-        virtual auto propagate(Model & model, std::optional<Proof> &, std::set<VariableID> &) const -> bool override;
+        virtual auto propagate(Model & model, std::optional<Proof> &, std::pmr::set<VariableID> &) const -> bool override;
 
         virtual auto start_proof(const Model &, Proof &) -> void override;
 
         virtual auto associated_variables() const -> std::set<VariableID> override;
 
         virtual auto priority() const -> int override;
+
+        virtual auto write_binary(BinaryModelWriter &) const -> void override;
+
+        virtual auto entailed(const Model &) const -> bool override;
+
+        virtual auto all_different_strength(const Model &) const -> std::optional<AllDifferentStrength> override;
 };
 
 #endif
@@ -0,0 +1,632 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+#include "parallel_search.hh"
+#include "all_different_constraint.hh"
+#include "model.hh"
+#include "proof.hh"
+#include "result.hh"
+#include "scratch.hh"
+#include "variable.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using std::atomic;
+using std::back_inserter;
+using std::deque;
+using std::make_shared;
+using std::make_unique;
+using std::move;
+using std::mutex;
+using std::nullopt;
+using std::numeric_limits;
+using std::optional;
+using std::shared_ptr;
+using std::size;
+using std::string;
+using std::thread;
+using std::unique_lock;
+using std::unique_ptr;
+using std::vector;
+
+using std::chrono::steady_clock;
+
+namespace this_thread = std::this_thread;
+
+namespace
+{
+struct ChoicePoint
+{
+    Model model;
+    VariableID variable;
+    int depth;
+    deque<VariableValue> unexplored;
+
+    ChoicePoint(const Model & m, VariableID v, int d) :
+        model(m),
+        variable(v),
+        depth(d)
+    {
+    }
+};
+
+struct ParallelSearchShared
+{
+    atomic<bool> stop{ false };
+    atomic<unsigned> busy;
+    atomic<unsigned long long> total_nodes{ 0 };
+
+    // when optimising, the best value anyone has found, so everyone can
+    // prune using it
+    atomic<bool> have_best{ false };
+    atomic<int> best{ 0 };
+
+    mutex result_mutex;
+    Result & result;
+
+    ParallelSearchShared(Result & r, unsigned threads) :
+        busy(threads),
+        result(r)
+    {
+    }
+};
+
+struct Worker
+{
+    SolveOptions options;
+    Result result;
+    optional<Proof> no_proof;
+    SearchState state;
+
+    // the choice points we have not finished, shallowest first. others may
+    // steal from these, so they must be accessed through the mutex.
+    mutex stack_mutex;
+    vector<shared_ptr<ChoicePoint> > stack;
+
+    Worker(const SolveOptions & o, unsigned seed_offset) :
+        options(o),
+        state(options, result, no_proof)
+    {
+        state.random.seed(options.random_seed + seed_offset);
+    }
+};
+
+auto share_solutions(const SolveOptions & options, mutex & result_mutex, Result & result,
+        atomic<bool> & have_best, atomic<int> & best) -> SolveOptions
+{
+    auto wrapped_options = options;
+    wrapped_options.on_solution = [&options, &result_mutex, &result, &have_best, &best] (const Model & m) {
+        unique_lock<mutex> guard{ result_mutex };
+        if (auto objective = m.objective()) {
+            int value{ *m.get_variable(objective->first)->values.begin() };
+            if (result.objective_value && (objective->second == ObjectiveDirection::Minimize ?
+                        value >= *result.objective_value : value <= *result.objective_value))
+                return;
+            result.objective_value = value;
+            result.solution.clear();
+            result.values.clear();
+            m.save_result(result);
+            best = value;
+            have_best = true;
+        }
+
+        if (options.on_solution)
+            options.on_solution(m);
+    };
+
+    return wrapped_options;
+}
+
+auto explore_node(int depth, Worker & worker, ParallelSearchShared & shared, Model & model) -> void
+{
+    if (! check_limits(worker.state)) {
+        shared.stop = true;
+        return;
+    }
+
+    ++worker.result.nodes;
+    ++shared.total_nodes;
+
+    if (shared.have_best)
+        worker.result.objective_value = shared.best.load();
+
+    if (! propagate_node(depth, worker.state, model))
+        return;
+
+    auto [ branch_variable_name, branch_variable ] = model.select_branch_variable(worker.state.options.variable_ordering);
+    if (! branch_variable) {
+        if (SearchOutcome::Satisfied == found_solution(worker.state, model)) {
+            unique_lock<mutex> guard{ shared.result_mutex };
+            if (shared.result.solution.empty()) {
+                shared.result.solution = move(worker.result.solution);
+                shared.result.values = move(worker.result.values);
+            }
+            shared.stop = true;
+        }
+        return;
+    }
+
+    auto values = order_values(worker.state, branch_variable_name, branch_variable->values);
+    auto choice_point = make_shared<ChoicePoint>(model, branch_variable_name, depth);
+    choice_point->unexplored.assign(values.begin(), values.end());
+
+    unique_lock<mutex> guard{ worker.stack_mutex };
+    worker.stack.push_back(move(choice_point));
+}
+
+auto explore_branch(Worker & worker, ParallelSearchShared & shared, const ChoicePoint & choice_point, VariableValue value) -> void
+{
+    Model child = choice_point.model;
+    child.get_variable(choice_point.variable)->values = {{ value }};
+    explore_node(choice_point.depth + 1, worker, shared, child);
+}
+
+auto steal(unsigned me, vector<unique_ptr<Worker> > & workers, ParallelSearchShared & shared,
+        shared_ptr<ChoicePoint> & stolen, VariableValue & value) -> bool
+{
+    for (unsigned offset = 1 ; offset < workers.size() ; ++offset) {
+        auto & victim = *workers[(me + offset) % workers.size()];
+        unique_lock<mutex> guard{ victim.stack_mutex };
+
+        // take the rightmost unexplored branch of the shallowest choice point,
+        // which is likely to be the biggest bit of work available. we become
+        // busy whilst the victim is still locked, so that nobody can see
+        // everyone as idle whilst there is still work to be done.
+        for (auto & choice_point : victim.stack)
+            if (! choice_point->unexplored.empty()) {
+                stolen = choice_point;
+                value = choice_point->unexplored.back();
+                choice_point->unexplored.pop_back();
+                ++shared.busy;
+                return true;
+            }
+    }
+
+    return false;
+}
+
+auto run_worker(unsigned me, vector<unique_ptr<Worker> > & workers, ParallelSearchShared & shared) -> void
+{
+    auto & worker = *workers[me];
+
+    while (true) {
+        // work through our own choice points, deepest first
+        while (! shared.stop) {
+            shared_ptr<ChoicePoint> choice_point;
+            VariableValue value;
+            {
+                unique_lock<mutex> guard{ worker.stack_mutex };
+                while ((! worker.stack.empty()) && worker.stack.back()->unexplored.empty())
+                    worker.stack.pop_back();
+                if (worker.stack.empty())
+                    break;
+
+                choice_point = worker.stack.back();
+                value = choice_point->unexplored.front();
+                choice_point->unexplored.pop_front();
+            }
+
+            explore_branch(worker, shared, *choice_point, value);
+        }
+
+        --shared.busy;
+
+        // we've run out of work, so find someone to take some from
+        while (true) {
+            if (shared.stop)
+                return;
+
+            shared_ptr<ChoicePoint> choice_point;
+            VariableValue value;
+            if (steal(me, workers, shared, choice_point, value)) {
+                explore_branch(worker, shared, *choice_point, value);
+                break;
+            }
+
+            // if nobody is busy, nobody can create more work
+            if (0 == shared.busy)
+                return;
+
+            this_thread::yield();
+        }
+    }
+}
+}
+
+auto parallel_search(
+        const Model & model,
+        const SolveOptions & options,
+        const optional<steady_clock::time_point> & deadline,
+        Result & result) -> SearchOutcome
+{
+    ParallelSearchShared shared{ result, options.threads };
+
+    // each worker gets its own copy of the options, so that solutions can be
+    // reported to the caller one at a time, and only when they improve on
+    // what any other worker has found
+    auto wrapped_options = share_solutions(options, shared.result_mutex, result, shared.have_best, shared.best);
+
+    vector<unique_ptr<Worker> > workers;
+    for (unsigned t = 0 ; t < options.threads ; ++t) {
+        workers.push_back(make_unique<Worker>(wrapped_options, t));
+        workers.back()->state.objective = model.objective();
+        workers.back()->state.deadline = deadline;
+        workers.back()->state.total_nodes = &shared.total_nodes;
+        workers.back()->state.stop = &shared.stop;
+    }
+
+    // the first worker starts at the top of the tree. everyone starts off
+    // busy, and then the other workers will immediately find they have
+    // nothing to do and go looking for work.
+    Model root = model;
+    explore_node(0, *workers[0], shared, root);
+
+    vector<thread> threads;
+    for (unsigned t = 0 ; t < options.threads ; ++t)
+        threads.emplace_back([&, t] () {
+                auto scratch_allocations_before = scratch_heap_allocations();
+                run_worker(t, workers, shared);
+                workers[t]->result.scratch_allocations += scratch_heap_allocations() - scratch_allocations_before;
+            });
+
+    for (auto & t : threads)
+        t.join();
+
+    for (auto & w : workers) {
+        result.nodes += w->result.nodes;
+        result.solution_count += w->result.solution_count;
+        result.scratch_allocations += w->result.scratch_allocations;
+        if (w->result.aborted && ! result.aborted)
+            result.aborted = w->result.aborted;
+    }
+
+    // several workers might have found a solution at the same time
+    if ((! options.all_solutions) && (! result.objective_value) && (! result.solution.empty())) {
+        result.solution_count = 1;
+        return SearchOutcome::Satisfied;
+    }
+    else if (result.aborted)
+        return SearchOutcome::Aborted;
+    else
+        return SearchOutcome::Exhausted;
+}
+
+namespace
+{
+struct Subproblem
+{
+    Model model;
+    int depth;
+};
+
+struct DecompositionShared
+{
+    atomic<unsigned long long> next_subproblem{ 0 };
+    atomic<unsigned long long> total_nodes{ 0 };
+
+    // when looking for a single solution, the earliest subproblem we know
+    // to have one. we always report the solution from this subproblem, so
+    // that the answer does not depend upon timing.
+    atomic<unsigned long long> first_satisfied{ numeric_limits<unsigned long long>::max() };
+
+    atomic<bool> have_best{ false };
+    atomic<int> best{ 0 };
+
+    mutex result_mutex;
+    Result & result;
+
+    explicit DecompositionShared(Result & r) :
+        result(r)
+    {
+    }
+};
+
+struct DecompositionWorker
+{
+    SolveOptions options;
+    Result result;
+    optional<Proof> no_proof;
+    SearchState state;
+
+    // which subproblem we are working on, and whether someone has found a
+    // solution to an earlier one and so we should give up on it
+    atomic<unsigned long long> current{ 0 };
+    atomic<bool> stop{ false };
+
+    explicit DecompositionWorker(const SolveOptions & o) :
+        options(o),
+        state(options, result, no_proof)
+    {
+    }
+};
+
+// expand the search tree one level at a time, until there are at least target
+// subproblems or nothing left to branch on. everything we return has been
+// propagated and is consistent, and the order is always the same.
+auto decompose(const Model & model, SearchState & state, unsigned long long target) -> optional<vector<Subproblem> >
+{
+    vector<Subproblem> frontier;
+
+    if (! check_limits(state))
+        return nullopt;
+    ++state.result.nodes;
+
+    Model root = model;
+    if (propagate_node(0, state, root))
+        frontier.push_back(Subproblem{ move(root), 0 });
+
+    bool expanded = true;
+    while (expanded && frontier.size() < target) {
+        expanded = false;
+        vector<Subproblem> next_frontier;
+        for (auto subproblem = frontier.begin() ; subproblem != frontier.end() ; ++subproblem) {
+            // once we have enough, the rest stay as they are, so that the
+            // order still follows the search tree
+            if (next_frontier.size() + (frontier.end() - subproblem) >= target) {
+                move(subproblem, frontier.end(), back_inserter(next_frontier));
+                break;
+            }
+
+            auto [ branch_variable_name, branch_variable ] = subproblem->model.select_branch_variable(state.options.variable_ordering);
+            if (! branch_variable) {
+                next_frontier.push_back(move(*subproblem));
+                continue;
+            }
+
+            expanded = true;
+            for (auto & value : order_values(state, branch_variable_name, branch_variable->values)) {
+                if (! check_limits(state))
+                    return nullopt;
+                ++state.result.nodes;
+
+                Model child = subproblem->model;
+                child.get_variable(branch_variable_name)->values = {{ value }};
+                if (propagate_node(subproblem->depth + 1, state, child))
+                    next_frontier.push_back(Subproblem{ move(child), subproblem->depth + 1 });
+            }
+        }
+
+        frontier = move(next_frontier);
+    }
+
+    return frontier;
+}
+
+auto run_decomposition_worker(unsigned me, vector<unique_ptr<DecompositionWorker> > & workers,
+        DecompositionShared & shared, const vector<Subproblem> & subproblems) -> void
+{
+    auto & worker = *workers[me];
+
+    while (true) {
+        auto index = shared.next_subproblem++;
+        if (index >= subproblems.size())
+            return;
+
+        worker.current = index;
+        worker.stop = false;
+
+        // if an earlier subproblem has a solution, this one is irrelevant
+        if (index > shared.first_satisfied)
+            continue;
+
+        // which thread gets which subproblem must not affect the search
+        worker.state.random.seed(worker.options.random_seed + index);
+        worker.state.phases = worker.options.hints;
+        if (shared.have_best)
+            worker.result.objective_value = shared.best.load();
+
+        auto outcome = search(subproblems[index].depth, 0, worker.state, subproblems[index].model);
+
+        if (SearchOutcome::Satisfied == outcome) {
+            unique_lock<mutex> guard{ shared.result_mutex };
+            if (index < shared.first_satisfied) {
+                shared.first_satisfied = index;
+                shared.result.solution = move(worker.result.solution);
+                shared.result.values = move(worker.result.values);
+                for (auto & w : workers)
+                    if (w->current > index)
+                        w->stop = true;
+            }
+            worker.result.solution.clear();
+            worker.result.values.clear();
+        }
+        else if (SearchOutcome::Aborted == outcome && worker.result.aborted)
+            return;
+    }
+}
+}
+
+auto decomposition_search(
+        const Model & model,
+        const SolveOptions & options,
+        const optional<steady_clock::time_point> & deadline,
+        Result & result) -> SearchOutcome
+{
+    DecompositionShared shared{ result };
+
+    optional<Proof> no_proof;
+    SearchState decomposition_state{ options, result, no_proof };
+    decomposition_state.objective = model.objective();
+    decomposition_state.deadline = deadline;
+
+    auto subproblems = decompose(model, decomposition_state,
+            (unsigned long long) { options.threads } * options.subproblems_per_thread);
+    if (! subproblems)
+        return SearchOutcome::Aborted;
+
+    result.subproblems = subproblems->size();
+    shared.total_nodes = result.nodes;
+
+    auto wrapped_options = share_solutions(options, shared.result_mutex, result, shared.have_best, shared.best);
+
+    vector<unique_ptr<DecompositionWorker> > workers;
+    for (unsigned t = 0 ; t < options.threads ; ++t) {
+        workers.push_back(make_unique<DecompositionWorker>(wrapped_options));
+        workers.back()->state.objective = model.objective();
+        workers.back()->state.deadline = deadline;
+        workers.back()->state.total_nodes = &shared.total_nodes;
+        workers.back()->state.stop = &workers.back()->stop;
+    }
+
+    vector<thread> threads;
+    for (unsigned t = 0 ; t < options.threads ; ++t)
+        threads.emplace_back([&, t] () {
+                auto scratch_allocations_before = scratch_heap_allocations();
+                run_decomposition_worker(t, workers, shared, *subproblems);
+                workers[t]->result.scratch_allocations += scratch_heap_allocations() - scratch_allocations_before;
+            });
+
+    for (auto & t : threads)
+        t.join();
+
+    for (auto & w : workers) {
+        result.nodes += w->result.nodes;
+        result.solution_count += w->result.solution_count;
+        result.scratch_allocations += w->result.scratch_allocations;
+        if (w->result.aborted && ! result.aborted)
+            result.aborted = w->result.aborted;
+    }
+
+    if ((! options.all_solutions) && (! result.objective_value) && (! result.solution.empty())) {
+        result.solution_count = 1;
+        return SearchOutcome::Satisfied;
+    }
+    else if (result.aborted)
+        return SearchOutcome::Aborted;
+    else
+        return SearchOutcome::Exhausted;
+}
+
+namespace
+{
+struct PortfolioConfiguration
+{
+    VariableOrdering variable_ordering;
+    ValueOrdering value_ordering;
+    optional<AllDifferentStrength> all_different_strength;
+    string description;
+};
+
+// what we race against whatever we were asked to run. if there are more
+// threads than this, we go round again, with different random seeds.
+const PortfolioConfiguration portfolio_configurations[] = {
+    { VariableOrdering::SmallestDomain,   ValueOrdering::Random,      nullopt,                         "dom random" },
+    { VariableOrdering::DomainOverDegree, ValueOrdering::Min,         nullopt,                         "domdeg min" },
+    { VariableOrdering::SmallestDomain,   ValueOrdering::PhaseSaving, AllDifferentStrength::Matching,  "dom phase matching" },
+    { VariableOrdering::InputOrder,       ValueOrdering::Median,      nullopt,                         "input median" },
+    { VariableOrdering::DomainOverDegree, ValueOrdering::Random,      AllDifferentStrength::Matching,  "domdeg random matching" },
+    { VariableOrdering::SmallestDomain,   ValueOrdering::Max,         AllDifferentStrength::GAC,       "dom max gac" },
+    { VariableOrdering::InputOrder,       ValueOrdering::Random,      nullopt,                         "input random" }
+};
+
+struct PortfolioShared
+{
+    atomic<bool> stop{ false };
+    atomic<unsigned long long> total_nodes{ 0 };
+    atomic<bool> have_best{ false };
+    atomic<int> best{ 0 };
+
+    // the first thread to finish without hitting a limit wins
+    mutex result_mutex;
+    Result & result;
+    optional<unsigned> winner;
+    SearchOutcome winning_outcome = SearchOutcome::Aborted;
+
+    explicit PortfolioShared(Result & r) :
+        result(r)
+    {
+    }
+};
+}
+
+auto portfolio_search(
+        const Model & model,
+        const SolveOptions & options,
+        const optional<steady_clock::time_point> & deadline,
+        Result & result) -> SearchOutcome
+{
+    PortfolioShared shared{ result };
+
+    auto wrapped_options = share_solutions(options, shared.result_mutex, result, shared.have_best, shared.best);
+
+    // the models only differ in their domains and settings, and share their
+    // constraints and names
+    vector<unique_ptr<Worker> > workers;
+    vector<Model> models;
+    vector<string> descriptions;
+    for (unsigned t = 0 ; t < options.threads ; ++t) {
+        auto configured_options = wrapped_options;
+        models.push_back(model);
+        if (0 == t)
+            descriptions.push_back("default");
+        else {
+            auto & configuration = portfolio_configurations[(t - 1) % size(portfolio_configurations)];
+            configured_options.variable_ordering = configuration.variable_ordering;
+            configured_options.value_ordering = configuration.value_ordering;
+            if (configuration.all_different_strength)
+                models.back().override_all_different_strength(*configuration.all_different_strength);
+            descriptions.push_back(configuration.description);
+        }
+
+        workers.push_back(make_unique<Worker>(configured_options, t));
+        workers.back()->state.objective = model.objective();
+        workers.back()->state.deadline = deadline;
+        workers.back()->state.total_nodes = &shared.total_nodes;
+        workers.back()->state.stop = &shared.stop;
+        workers.back()->state.have_best = &shared.have_best;
+        workers.back()->state.best = &shared.best;
+    }
+
+    vector<thread> threads;
+    for (unsigned t = 0 ; t < options.threads ; ++t)
+        threads.emplace_back([&, t] () {
+                auto & worker = *workers[t];
+                auto scratch_allocations_before = scratch_heap_allocations();
+                auto outcome = search(0, 0, worker.state, models[t]);
+                worker.result.scratch_allocations += scratch_heap_allocations() - scratch_allocations_before;
+
+                // if we were told to stop, or hit a limit, we know nothing
+                if (SearchOutcome::Aborted == outcome)
+                    return;
+
+                unique_lock<mutex> guard{ shared.result_mutex };
+                if (! shared.winner) {
+                    shared.winner = t;
+                    shared.winning_outcome = outcome;
+                    if (SearchOutcome::Satisfied == outcome) {
+                        result.solution = move(worker.result.solution);
+                        result.values = move(worker.result.values);
+                    }
+                    shared.stop = true;
+                }
+            });
+
+    for (auto & t : threads)
+        t.join();
+
+    for (auto & w : workers) {
+        result.nodes += w->result.nodes;
+        result.scratch_allocations += w->result.scratch_allocations;
+    }
+
+    if (shared.winner) {
+        result.winning_configuration = descriptions[*shared.winner];
+        result.solution_count = workers[*shared.winner]->result.solution_count;
+        return shared.winning_outcome;
+    }
+
+    for (auto & w : workers)
+        if (w->result.aborted && ! result.aborted)
+            result.aborted = w->result.aborted;
+
+    return SearchOutcome::Aborted;
+}
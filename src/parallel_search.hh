@@ -0,0 +1,48 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+#ifndef CERTIFIED_CONSTRAINT_SOLVER_GUARD_SRC_PARALLEL_SEARCH_HH
+#define CERTIFIED_CONSTRAINT_SOLVER_GUARD_SRC_PARALLEL_SEARCH_HH 1
+
+#include "model-fwd.hh"
+#include "result-fwd.hh"
+#include "search.hh"
+#include "solve.hh"
+
+#include <chrono>
+#include <optional>
+
+/**
+ * Depth-first search using several threads, where idle threads steal
+ * unexplored branches from busy threads. Does not support proof logging or
+ * discrepancy search.
+ */
+auto parallel_search(
+        const Model & model,
+        const SolveOptions & options,
+        const std::optional<std::chrono::steady_clock::time_point> & deadline,
+        Result & result) -> SearchOutcome;
+
+/**
+ * Embarrassingly parallel search: split the problem into many subproblems up
+ * front, and then have several threads solve them from a shared queue. The
+ * solution reported does not depend upon timing.
+ * Does not support proof logging or discrepancy search.
+ */
+auto decomposition_search(
+        const Model & model,
+        const SolveOptions & options,
+        const std::optional<std::chrono::steady_clock::time_point> & deadline,
+        Result & result) -> SearchOutcome;
+
+/**
+ * Run a differently configured search on each thread, and take the answer from
+ * whichever finishes first. Does not support proof logging, discrepancy search,
+ * or finding all solutions.
+ */
+auto portfolio_search(
+        const Model & model,
+        const SolveOptions & options,
+        const std::optional<std::chrono::steady_clock::time_point> & deadline,
+        Result & result) -> SearchOutcome;
+
+#endif
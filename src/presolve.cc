@@ -0,0 +1,108 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+#include "presolve.hh"
+#include "all_different_constraint.hh"
+#include "constraint.hh"
+#include "model.hh"
+#include "proof.hh"
+#include "result.hh"
+#include "variable.hh"
+
+#include <algorithm>
+#include <iomanip>
+#include <map>
+#include <set>
+#include <vector>
+
+using std::endl;
+using std::includes;
+using std::map;
+using std::multimap;
+using std::optional;
+using std::set;
+using std::vector;
+
+namespace
+{
+struct AllDifferentClique
+{
+    const Constraint * constraint;
+    set<VariableID> vars;
+    AllDifferentStrength strength;
+};
+
+// does d make c redundant? it must cover all of c's variables, propagate at
+// least as strongly, and if the two are the same, the earlier one stays
+auto covers(const AllDifferentClique & d, unsigned d_position, const AllDifferentClique & c, unsigned c_position) -> bool
+{
+    if (d_position == c_position || d.strength < c.strength || d.vars.size() < c.vars.size())
+        return false;
+
+    if (! includes(d.vars.begin(), d.vars.end(), c.vars.begin(), c.vars.end()))
+        return false;
+
+    return d.vars.size() > c.vars.size() || d.strength > c.strength || d_position < c_position;
+}
+
+auto find_redundant_cliques(const Model & model) -> set<const Constraint *>
+{
+    vector<AllDifferentClique> cliques;
+    model.for_each_constraint([&] (const Constraint & c) {
+            if (auto strength = c.all_different_strength(model))
+                cliques.push_back(AllDifferentClique{ &c, c.associated_variables(), *strength });
+            });
+
+    // only cliques containing c's first variable can cover c
+    multimap<VariableID, unsigned> cliques_containing;
+    for (unsigned i = 0 ; i < cliques.size() ; ++i)
+        for (auto & v : cliques[i].vars)
+            cliques_containing.emplace(v, i);
+
+    set<const Constraint *> result;
+    for (unsigned c = 0 ; c < cliques.size() ; ++c) {
+        if (cliques[c].vars.empty())
+            continue;
+
+        auto candidates = cliques_containing.equal_range(*cliques[c].vars.begin());
+        for (auto d = candidates.first ; d != candidates.second ; ++d)
+            if (covers(cliques[d->second], d->second, cliques[c], c)) {
+                result.insert(cliques[c].constraint);
+                break;
+            }
+    }
+
+    return result;
+}
+}
+
+auto presolve(Model & model, optional<Proof> & proof, Result & result) -> bool
+{
+    if (proof && proof->comments(ProofComments::Minimal))
+        proof->proof_stream() << "* presolving at the root" << endl;
+
+    unsigned long long values_before = 0;
+    model.for_each_variable([&] (VariableID, const Variable & v) { values_before += v.values.size(); });
+
+    if (! model.propagate(proof))
+        return false;
+
+    unsigned long long values_after = 0;
+    model.for_each_variable([&] (VariableID, const Variable & v) { values_after += v.values.size(); });
+    result.removed_by_presolve = values_before - values_after;
+
+    // if whatever covers a redundant constraint is entailed, then so is the
+    // redundant constraint, so we can safely remove both at once
+    auto redundant = find_redundant_cliques(model);
+    result.constraints_removed_by_presolve = model.remove_constraints_if([&] (const Constraint & c) {
+            return redundant.count(&c) || c.entailed(model);
+            });
+
+    result.variables_eliminated_by_presolve = model.eliminate_fixed_variables();
+
+    if (proof && proof->comments(ProofComments::Minimal))
+        proof->proof_stream() << "* presolve removed " << result.removed_by_presolve << " values and "
+            << result.constraints_removed_by_presolve << " constraints, and eliminated "
+            << result.variables_eliminated_by_presolve << " variables" << endl;
+
+    return true;
+}
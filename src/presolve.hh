@@ -0,0 +1,23 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+#ifndef CERTIFIED_CONSTRAINT_SOLVER_GUARD_SRC_PRESOLVE_HH
+#define CERTIFIED_CONSTRAINT_SOLVER_GUARD_SRC_PRESOLVE_HH 1
+
+#include "model-fwd.hh"
+#include "proof-fwd.hh"
+#include "result-fwd.hh"
+
+#include <optional>
+
+/**
+ * Simplify the model before search: propagate to a fixed point at the root,
+ * which applies unary constraints and shrinks domains, then remove
+ * constraints which are entailed or which another constraint makes
+ * redundant, and finally move fixed variables that are left in no
+ * constraints out of the way of search. Domain reductions are logged to the
+ * proof as usual, and removing constraints needs no justification. Returns
+ * false if this shows the model to be inconsistent.
+ */
+[[ nodiscard ]] auto presolve(Model & model, std::optional<Proof> & proof, Result & result) -> bool;
+
+#endif
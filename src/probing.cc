@@ -0,0 +1,129 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+#include "probing.hh"
+#include "model.hh"
+#include "proof.hh"
+#include "result.hh"
+#include "scratch.hh"
+#include "variable.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <iomanip>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using std::atomic;
+using std::endl;
+using std::max;
+using std::min;
+using std::optional;
+using std::pair;
+using std::thread;
+using std::vector;
+
+using std::chrono::steady_clock;
+
+auto probe_at_root(
+        Model & model,
+        const SolveOptions & options,
+        optional<Proof> & proof,
+        Result & result,
+        const optional<steady_clock::time_point> & deadline) -> bool
+{
+    if (proof && proof->comments(ProofComments::Minimal))
+        proof->proof_stream() << "* probing at the root" << endl;
+
+    if (! model.propagate(proof))
+        return false;
+
+    while (true) {
+        vector<pair<VariableID, VariableValue> > candidates;
+        model.for_each_variable([&] (VariableID name, const Variable & v) {
+                if (v.values.size() != 1)
+                    for (auto & value : v.values)
+                        candidates.emplace_back(name, value);
+                });
+
+        // each probe gets its own copy of the model, so they can all be done
+        // at once. we use char rather than bool so that different threads
+        // can write to neighbouring elements.
+        vector<char> failed(candidates.size(), 0);
+        atomic<unsigned long long> next_candidate{ 0 }, probes{ 0 }, scratch_allocations{ 0 };
+        atomic<bool> out_of_time{ false };
+
+        auto run = [&] () {
+            for (auto c = next_candidate++ ; c < candidates.size() ; c = next_candidate++) {
+                if ((deadline && steady_clock::now() >= *deadline) || (options.interrupted && *options.interrupted)) {
+                    out_of_time = true;
+                    return;
+                }
+
+                ++probes;
+                Model probe = model;
+                probe.get_variable(candidates[c].first)->values = {{ candidates[c].second }};
+                optional<Proof> no_proof;
+                failed[c] = ! probe.propagate(no_proof);
+            }
+        };
+
+        vector<thread> threads;
+        for (unsigned t = 0 ; t < max<unsigned long long>(1, min<unsigned long long>(options.threads, candidates.size())) ; ++t)
+            threads.emplace_back([&] () {
+                    auto scratch_allocations_before = scratch_heap_allocations();
+                    run();
+                    scratch_allocations += scratch_heap_allocations() - scratch_allocations_before;
+                });
+        for (auto & t : threads)
+            t.join();
+
+        result.probes += probes;
+        result.scratch_allocations += scratch_allocations;
+
+        // now go back and remove everything that failed, repeating the probe
+        // if we need to justify it in the proof
+        bool removed_any = false;
+        for (unsigned c = 0 ; c < candidates.size() ; ++c) {
+            if (! failed[c])
+                continue;
+
+            auto & [ var, value ] = candidates[c];
+            if (proof) {
+                proof->enstackinate_guess(var, model.original_name(var), value);
+                Model probe = model;
+                probe.get_variable(var)->values = {{ value }};
+                // propagation only gets stronger as values are removed, so
+                // this shouldn't happen, but if it does then we have nothing
+                // to justify removing the value with, and so we keep it
+                if (probe.propagate(proof)) {
+                    if (proof->comments(ProofComments::Minimal))
+                        proof->proof_stream() << "* probe did not fail the second time" << endl;
+                    proof->undo_guess();
+                    continue;
+                }
+                proof->incorrect_guess();
+            }
+
+            auto & values = model.get_variable(var)->values;
+            values.erase(value);
+            ++result.removed_by_probing;
+            removed_any = true;
+
+            if (values.empty()) {
+                if (proof && proof->comments(ProofComments::Minimal))
+                    proof->proof_stream() << "* probing removed every value from " << model.original_name(var) << endl;
+                return false;
+            }
+        }
+
+        if (out_of_time || ! removed_any)
+            return true;
+
+        if (proof && proof->comments(ProofComments::Minimal))
+            proof->proof_stream() << "* propagating after probing" << endl;
+
+        if (! model.propagate(proof))
+            return false;
+    }
+}
@@ -0,0 +1,28 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+#ifndef CERTIFIED_CONSTRAINT_SOLVER_GUARD_SRC_PROBING_HH
+#define CERTIFIED_CONSTRAINT_SOLVER_GUARD_SRC_PROBING_HH 1
+
+#include "model-fwd.hh"
+#include "proof-fwd.hh"
+#include "result-fwd.hh"
+#include "solve.hh"
+
+#include <chrono>
+#include <optional>
+
+/**
+ * Make the model singleton arc consistent, by trying every value of every
+ * variable in turn and removing it if propagation fails, until nothing
+ * changes. Probes are shared out between threads, and only the ones that fail
+ * are repeated to write the proof. Returns false if this shows the model to
+ * be inconsistent.
+ */
+[[ nodiscard ]] auto probe_at_root(
+        Model & model,
+        const SolveOptions & options,
+        std::optional<Proof> & proof,
+        Result & result,
+        const std::optional<std::chrono::steady_clock::time_point> & deadline) -> bool;
+
+#endif
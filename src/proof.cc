@@ -1,13 +1,16 @@
 /* vim: set sw=4 sts=4 et foldmethod=syntax : */
 
 #include "proof.hh"
+#include "proof_writer.hh"
 #include "variable.hh"
 
 #include <algorithm>
+#include <charconv>
 #include <fstream>
 #include <iterator>
 #include <list>
 #include <map>
+#include <ostream>
 #include <sstream>
 #include <tuple>
 #include <utility>
@@ -19,11 +22,13 @@ using std::list;
 using std::make_unique;
 using std::map;
 using std::ofstream;
+using std::ostream;
 using std::ostreambuf_iterator;
 using std::pair;
 using std::string;
 using std::stringstream;
 using std::to_string;
+using std::to_chars;
 using std::tuple;
 
 ProofError::ProofError(const string & m) noexcept :
@@ -38,8 +43,11 @@ auto ProofError::what() const noexcept -> const char *
 
 struct Proof::Imp
 {
+    string opb_filename, log_filename;
     ofstream opb_file;
-    ofstream log_file;
+    ProofWriter log_writer;
+    ostream log_file{ &log_writer };
+    stringstream opb_objective;
     stringstream opb_body_file;
 
     ProofLineNumber model_constraints_line{ 0 };
@@ -56,21 +64,25 @@ struct Proof::Imp
     bool asserty = false;
     bool levels = false;
     bool numbered_variables = false;
+    ProofComments comments = ProofComments::Full;
 };
 
-Proof::Proof(const string & opb, const string & log, bool asserty, bool levels, bool numbered_variables)
+Proof::Proof(const string & opb, const string & log, bool asserty, bool levels, bool numbered_variables,
+        ProofComments comments)
 {
     _imp = make_unique<Proof::Imp>();
     _imp->asserty = asserty;
     _imp->levels = levels;
     _imp->numbered_variables = numbered_variables;
+    _imp->comments = comments;
+    _imp->opb_filename = opb;
+    _imp->log_filename = log;
 
     _imp->opb_file.open(opb);
     if (! _imp->opb_file)
         throw ProofError{ "Cannot write proof model to '" + opb + "'" };
 
-    _imp->log_file.open(log);
-    if (! _imp->log_file)
+    if (! _imp->log_writer.open(log))
         throw ProofError{ "Cannot write proof model to '" + log + "'" };
 }
 
@@ -85,6 +97,7 @@ auto Proof::write_header() -> void
     proof_stream() << "pseudo-Boolean proof version 1.0" << endl;
 
     _imp->opb_file << "* #variable= " << _imp->number_of_variables << " #constraint= " << _imp->model_constraints_line << endl;
+    copy(istreambuf_iterator<char>{ _imp->opb_objective }, istreambuf_iterator<char>{}, ostreambuf_iterator<char>{ _imp->opb_file });
      copy(istreambuf_iterator<char>{ _imp->opb_body_file }, istreambuf_iterator<char>{}, ostreambuf_iterator<char>{ _imp->opb_file });
 }
 
@@ -125,6 +138,11 @@ auto Proof::wrote_variable_takes_at_most_one_value(VariableID n, ProofLineNumber
     _imp->variable_takes_at_most_one_value.emplace(n, v);
 }
 
+auto Proof::objective_stream() -> std::ostream &
+{
+    return _imp->opb_objective;
+}
+
 auto Proof::model_stream() -> std::ostream &
 {
     return _imp->opb_body_file;
@@ -175,30 +193,84 @@ auto Proof::levels() const -> bool
     return _imp->levels;
 }
 
+auto Proof::comments(ProofComments level) const -> bool
+{
+    return _imp->comments >= level;
+}
+
+namespace
+{
+// we write guesses at every search node, so format them by hand rather than
+// going through a stringstream
+auto append_number(string & s, long long n) -> void
+{
+    char buf[24];
+    auto [ end, _ ] = to_chars(buf, buf + sizeof(buf), n);
+    s.append(buf, end);
+}
+
+auto describe_guesses(const Proof & proof, const list<tuple<VariableID, string, VariableValue> > & stack) -> string
+{
+    string result;
+    for (auto & [ s, n, t ] : stack) {
+        result += ' ';
+        result += n;
+        result += '=';
+        append_number(result, int{ t });
+        result += " (x";
+        result += proof.variable_value_mapping(s, t).underlying_value();
+        result += ')';
+    }
+    return result;
+}
+}
+
 auto Proof::enstackinate_guess(VariableID var, const string & name, VariableValue val) -> void
 {
     _imp->stack.push_back(tuple{ var, name, val });
-    proof_stream() << "* guessing";
-    for (auto & [ s, n, t ] : _imp->stack)
-        proof_stream() << " " << n << "=" << int{ t } << " (" << "x" << variable_value_mapping(s, t) << ")";
-    proof_stream() << endl;
+    if (comments(ProofComments::Full))
+        proof_stream() << "* guessing" << describe_guesses(*this, _imp->stack) << endl;
 }
 
 auto Proof::incorrect_guess() -> void
 {
-    proof_stream() << "* incorrect guess";
-    for (auto & [ s, n, t ] : _imp->stack)
-        proof_stream() << " " << n << "=" << int{ t } << " (" << "x" << variable_value_mapping(s, t) << ")";
-    proof_stream() << endl;
+    if (comments(ProofComments::Full))
+        proof_stream() << "* incorrect guess" << describe_guesses(*this, _imp->stack) << endl;
 
-    auto [ wrong_var, _, wrong_val ] = _imp->stack.back();
+    proof_stream() << incorrect_guess_line() << endl;
     _imp->stack.pop_back();
-
-    proof_stream() << "u ";
-    for (auto & [ var, _, val ] : _imp->stack)
-        proof_stream() << " -1 x" << variable_value_mapping(var, val);
-    proof_stream() << " -1 x" << variable_value_mapping(wrong_var, wrong_val);
-    proof_stream() << " >= -" << _imp->stack.size() << " ;" << endl;
     next_proof_line();
 }
 
+auto Proof::incorrect_guess_line() const -> string
+{
+    string result = "u ";
+    for (auto & [ var, _, val ] : _imp->stack) {
+        result += " -1 x";
+        result += variable_value_mapping(var, val).underlying_value();
+    }
+    result += " >= -";
+    append_number(result, _imp->stack.size() - 1);
+    result += " ;";
+    return result;
+}
+
+auto Proof::undo_guess() -> void
+{
+    if (comments(ProofComments::Full))
+        proof_stream() << "* abandoning guess" << describe_guesses(*this, _imp->stack) << endl;
+
+    _imp->stack.pop_back();
+}
+
+auto Proof::close() -> void
+{
+    if (_imp->opb_file.is_open()) {
+        _imp->opb_file.close();
+        if (! _imp->opb_file)
+            throw ProofError{ "Could not write proof model to '" + _imp->opb_filename + "'" };
+    }
+
+    if (! _imp->log_writer.close())
+        throw ProofError{ "Could not write proof log to '" + _imp->log_filename + "'" };
+}
@@ -23,6 +23,19 @@ class ProofError : public std::exception
         virtual auto what() const noexcept -> const char *;
 };
 
+/**
+ * How many '*' comments to write in the proof log. None and Minimal are for
+ * when the proof is going to be checked rather than read: Minimal keeps only
+ * the comments written once per run or once per solution, and Full also
+ * describes what happens at every search node.
+ */
+enum class ProofComments
+{
+    None,
+    Minimal,
+    Full
+};
+
 class Proof
 {
     private:
@@ -30,7 +43,8 @@ class Proof
         std::unique_ptr<Imp> _imp;
 
     public:
-        Proof(const std::string & opb_file, const std::string & log_file, bool asserty, bool levels, bool numbered_variables);
+        Proof(const std::string & opb_file, const std::string & log_file, bool asserty, bool levels, bool numbered_variables,
+                ProofComments comments = ProofComments::Full);
         Proof(Proof &&);
         ~Proof();
         auto operator= (Proof &&) -> Proof &;
@@ -47,6 +61,7 @@ class Proof
         auto wrote_variable_takes_at_least_one_value(VariableID, ProofLineNumber) -> void;
         auto wrote_variable_takes_at_most_one_value(VariableID, ProofLineNumber) -> void;
 
+        auto objective_stream() -> std::ostream &;
         auto model_stream() -> std::ostream &;
         [[ nodiscard ]] auto last_model_line() const -> ProofLineNumber;
         auto next_model_line() -> void;
@@ -61,8 +76,21 @@ class Proof
         auto enstackinate_guess(VariableID, const std::string &, VariableValue) -> void;
         auto incorrect_guess() -> void;
 
+        // the line incorrect_guess() would write, for when it has to be written
+        // later on, or somewhere else
+        [[ nodiscard ]] auto incorrect_guess_line() const -> std::string;
+        auto undo_guess() -> void;
+
         auto asserty() const -> bool;
         auto levels() const -> bool;
+
+        // should comments at this level be written?
+        [[ nodiscard ]] auto comments(ProofComments) const -> bool;
+
+        // write out everything, and throw ProofError if any of it could not
+        // be written. otherwise this happens on destruction, but without any
+        // way of saying that it failed.
+        auto close() -> void;
 };
 
 #endif
@@ -0,0 +1,161 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+#include "proof_writer.hh"
+
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using std::condition_variable;
+using std::deque;
+using std::fclose;
+using std::FILE;
+using std::fopen;
+using std::fwrite;
+using std::lock_guard;
+using std::make_unique;
+using std::move;
+using std::mutex;
+using std::setvbuf;
+using std::size_t;
+using std::string;
+using std::thread;
+using std::unique_lock;
+using std::vector;
+
+// big enough that we make very few system calls, and enough of them that
+// the solver rarely has to wait for the disk to catch up
+const size_t buffer_size = 1 << 20;
+const unsigned buffers_in_flight = 4;
+
+struct ProofWriter::Imp
+{
+    FILE * file = nullptr;
+    vector<char> current;
+
+    mutex lock;
+    condition_variable changed;
+    deque<vector<char> > full, spare;
+    unsigned in_flight = 0;
+    bool closing = false, failed = false;
+    thread writer;
+
+    auto write_buffers() -> void;
+};
+
+auto ProofWriter::Imp::write_buffers() -> void
+{
+    unique_lock guard{ lock };
+    while (true) {
+        changed.wait(guard, [&] { return closing || ! full.empty(); });
+        if (full.empty())
+            return;
+
+        auto buffer = move(full.front());
+        full.pop_front();
+
+        guard.unlock();
+        bool written = buffer.size() == fwrite(buffer.data(), 1, buffer.size(), file);
+        guard.lock();
+
+        if (! written)
+            failed = true;
+        buffer.clear();
+        spare.push_back(move(buffer));
+        --in_flight;
+        changed.notify_all();
+    }
+}
+
+ProofWriter::ProofWriter() :
+    _imp(make_unique<Imp>())
+{
+}
+
+ProofWriter::~ProofWriter()
+{
+    close();
+}
+
+auto ProofWriter::open(const string & filename) -> bool
+{
+    _imp->file = fopen(filename.c_str(), "w");
+    if (! _imp->file)
+        return false;
+
+    // we do our own buffering, and only ever hand over big chunks
+    setvbuf(_imp->file, nullptr, _IONBF, 0);
+
+    _imp->current.resize(buffer_size);
+    setp(_imp->current.data(), _imp->current.data() + _imp->current.size());
+    _imp->writer = thread{ [imp = _imp.get()] { imp->write_buffers(); } };
+    return true;
+}
+
+auto ProofWriter::_hand_off() -> void
+{
+    auto used = pptr() - pbase();
+    if (0 == used)
+        return;
+
+    _imp->current.resize(used);
+    {
+        unique_lock guard{ _imp->lock };
+        _imp->changed.wait(guard, [&] { return _imp->in_flight < buffers_in_flight; });
+        _imp->full.push_back(move(_imp->current));
+        ++_imp->in_flight;
+
+        if (_imp->spare.empty())
+            _imp->current = vector<char>{};
+        else {
+            _imp->current = move(_imp->spare.front());
+            _imp->spare.pop_front();
+        }
+    }
+    _imp->changed.notify_all();
+
+    _imp->current.resize(buffer_size);
+    setp(_imp->current.data(), _imp->current.data() + _imp->current.size());
+}
+
+auto ProofWriter::overflow(int_type c) -> int_type
+{
+    if (! _imp->file)
+        return traits_type::eof();
+
+    _hand_off();
+    if (! traits_type::eq_int_type(c, traits_type::eof())) {
+        *pptr() = traits_type::to_char_type(c);
+        pbump(1);
+    }
+
+    return traits_type::not_eof(c);
+}
+
+auto ProofWriter::sync() -> int
+{
+    return 0;
+}
+
+auto ProofWriter::close() -> bool
+{
+    if (! _imp->file)
+        return true;
+
+    _hand_off();
+    {
+        lock_guard guard{ _imp->lock };
+        _imp->closing = true;
+    }
+    _imp->changed.notify_all();
+    _imp->writer.join();
+
+    bool ok = (! _imp->failed) && 0 == fclose(_imp->file);
+    _imp->file = nullptr;
+    setp(nullptr, nullptr);
+    return ok;
+}
@@ -0,0 +1,46 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+#ifndef CERTIFIED_CONSTRAINT_SOLVER_GUARD_SRC_PROOF_WRITER_HH
+#define CERTIFIED_CONSTRAINT_SOLVER_GUARD_SRC_PROOF_WRITER_HH 1
+
+#include <memory>
+#include <streambuf>
+#include <string>
+
+/**
+ * A stream buffer for writing proof logs. Lines are formatted into a large
+ * buffer, and full buffers are handed to a background thread which writes
+ * them out, so the solver only waits for the disk if it gets several
+ * buffers ahead. Flushing the stream, which std::endl does, is ignored:
+ * everything is written when the writer is closed or destroyed, and so a
+ * log is only complete once this has happened.
+ */
+class ProofWriter : public std::streambuf
+{
+    private:
+        struct Imp;
+        std::unique_ptr<Imp> _imp;
+
+        auto _hand_off() -> void;
+
+    protected:
+        virtual auto overflow(int_type) -> int_type override;
+        virtual auto sync() -> int override;
+
+    public:
+        ProofWriter();
+        ~ProofWriter();
+
+        ProofWriter(const ProofWriter &) = delete;
+        auto operator= (const ProofWriter &) -> ProofWriter & = delete;
+
+        [[ nodiscard ]] auto open(const std::string & filename) -> bool;
+
+        /**
+         * Write out everything, and wait for it to reach the file. Returns
+         * false if anything could not be written.
+         */
+        auto close() -> bool;
+};
+
+#endif
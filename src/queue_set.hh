@@ -3,30 +3,65 @@
 #ifndef CERTIFIED_CONSTRAINT_SOLVER_GUARD_SRC_QUEUE_SET_HH
 #define CERTIFIED_CONSTRAINT_SOLVER_GUARD_SRC_QUEUE_SET_HH 1
 
-template <typename T_>
+#include <cstddef>
+#include <memory_resource>
+#include <vector>
+
+/**
+ * A queue of small integer handles, each with a priority. Everything of the
+ * lowest priority comes out first, in the order it went in, and enqueueing
+ * something that is already queued does nothing. Memory comes from the
+ * given resource.
+ */
 class QueueSet
 {
     private:
-        std::set<T_> _values;
+        std::pmr::vector<std::pmr::vector<unsigned> > _queues;
+        std::pmr::vector<std::size_t> _heads;
+        std::pmr::vector<char> _queued;
+        std::size_t _size = 0;
+        unsigned _lowest = 0;
 
     public:
-        QueueSet() = default;
+        QueueSet(unsigned number_of_handles, unsigned number_of_priorities,
+                std::pmr::memory_resource * resource = std::pmr::get_default_resource()) :
+            _queues(number_of_priorities, resource),
+            _heads(number_of_priorities, 0, resource),
+            _queued(number_of_handles, 0, resource)
+        {
+        }
+
         ~QueueSet() = default;
 
         auto empty() const -> bool
         {
-            return _values.empty();
+            return 0 == _size;
         }
 
-        auto enqueue(T_ t) -> void
+        auto enqueue(unsigned handle, unsigned priority) -> void
         {
-            _values.insert(t);
+            if (_queued[handle])
+                return;
+
+            _queued[handle] = 1;
+            _queues[priority].push_back(handle);
+            ++_size;
+            if (priority < _lowest)
+                _lowest = priority;
         }
 
-        auto dequeue() -> T_
+        auto dequeue() -> unsigned
         {
-            auto result = *_values.begin();
-            _values.erase(_values.begin());
+            while (_heads[_lowest] == _queues[_lowest].size()) {
+                // reuse the space, rather than letting it grow forever
+                _queues[_lowest].clear();
+                _heads[_lowest] = 0;
+                ++_lowest;
+            }
+
+            auto result = _queues[_lowest][_heads[_lowest]++];
+            _queued[result] = 0;
+            --_size;
             return result;
         }
 };
@@ -1,6 +1,7 @@
 /* vim: set sw=4 sts=4 et foldmethod=syntax : */
 
 #include "read_model.hh"
+#include "binary_model.hh"
 #include "model.hh"
 #include "constraint.hh"
 #include "table_constraint.hh"
@@ -8,22 +9,42 @@
 #include "equals_constant_constraint.hh"
 #include "all_different_constraint.hh"
 #include "variable.hh"
+#include "mapped_file.hh"
 
+#include <cctype>
+#include <charconv>
+#include <cstdint>
 #include <fstream>
+#include <iterator>
+#include <limits>
 #include <map>
 #include <memory>
 #include <sstream>
+#include <string_view>
+#include <system_error>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
+using std::errc;
+using std::from_chars;
+using std::getline;
+using std::int32_t;
 using std::ifstream;
+using std::istream;
+using std::istreambuf_iterator;
+using std::isspace;
 using std::make_shared;
 using std::map;
 using std::move;
+using std::numeric_limits;
+using std::pair;
 using std::set;
 using std::string;
+using std::string_view;
 using std::stringstream;
 using std::to_string;
+using std::unordered_map;
 using std::vector;
 
 InputError::InputError(const string & m) noexcept :
@@ -36,134 +57,285 @@ auto InputError::what() const noexcept -> const char *
     return _message.c_str();
 }
 
-auto read_model(const string & filename) -> Model
+namespace
 {
-    ifstream infile{ filename };
-    if (! infile)
-        throw InputError{ "Error reading from '" + filename + "'" };
+auto parse_int(string_view token, int & value) -> bool
+{
+    // from_chars doesn't allow an explicit plus sign, but we always have
+    if (token.size() > 1 && '+' == token[0])
+        token.remove_prefix(1);
+    auto [ end, ec ] = from_chars(token.data(), token.data() + token.size(), value);
+    return ec == errc{ } && end == token.data() + token.size();
+}
+
+// splits a model into whitespace separated tokens, without copying them, and
+// keeps track of where we are so that errors can say where they happened
+struct Tokenizer
+{
+    string_view text;
+    string_view::size_type position = 0;
+    unsigned line = 1;
+    string_view::size_type line_start = 0;
+
+    unsigned token_line = 1;
+    string_view::size_type token_column = 1;
+
+    explicit Tokenizer(string_view t) :
+        text(t)
+    {
+    }
 
-    string word;
+    auto skip_whitespace() -> void
+    {
+        while (position < text.size() && isspace(static_cast<unsigned char>(text[position]))) {
+            if ('\n' == text[position]) {
+                ++line;
+                line_start = position + 1;
+            }
+            ++position;
+        }
+    }
+
+    [[ nodiscard ]] auto next(string_view & token) -> bool
+    {
+        skip_whitespace();
+        if (position == text.size())
+            return false;
+
+        token_line = line;
+        token_column = position - line_start + 1;
+        auto start = position;
+        while (position < text.size() && ! isspace(static_cast<unsigned char>(text[position])))
+            ++position;
+        token = text.substr(start, position - start);
+        return true;
+    }
+
+    [[ nodiscard ]] auto next(int & value) -> bool
+    {
+        string_view token;
+        return next(token) && parse_int(token, value);
+    }
+
+    auto skip_line() -> void
+    {
+        auto end = text.find('\n', position);
+        position = (string_view::npos == end) ? text.size() : end;
+    }
+
+    auto error(const string & message) const -> InputError
+    {
+        return InputError{ "line " + to_string(token_line) + ", column " + to_string(token_column) + ": " + message };
+    }
+};
+
+// tuples are either a comma or space separated text file, one tuple per
+// line, or otherwise raw native-endian 32-bit integers, which we use in place
+auto load_table(Table & table, const string & filename) -> void
+{
+    auto file = shared_mapping(filename);
+    auto contents = file->contents();
+
+    if (filename.size() >= 4 && 0 == filename.compare(filename.size() - 4, 4, ".csv")) {
+        vector<VariableValue> tuple;
+        unsigned line_number = 0;
+        while (! contents.empty()) {
+            ++line_number;
+            auto end = contents.find('\n');
+            auto line = contents.substr(0, end);
+            contents.remove_prefix(string_view::npos == end ? contents.size() : end + 1);
+
+            tuple.clear();
+            while (! line.empty()) {
+                auto separator = line.find_first_of(", \t\r");
+                auto token = line.substr(0, separator);
+                line.remove_prefix(string_view::npos == separator ? line.size() : separator + 1);
+                if (token.empty())
+                    continue;
+
+                int value;
+                if (! parse_int(token, value))
+                    throw InputError{ "Bad value '" + string{ token } + "' on line " + to_string(line_number) + " of '" + filename + "'" };
+                tuple.push_back(VariableValue{ value });
+            }
+
+            if (tuple.empty())
+                continue;
+            if (tuple.size() != unsigned(table.arity()))
+                throw InputError{ "Wrong number of values on line " + to_string(line_number) + " of '" + filename + "'" };
+            table.add_tuple(tuple);
+        }
+    }
+    else {
+        if (table.arity() <= 0 || 0 != contents.size() % (table.arity() * sizeof(int32_t)))
+            throw InputError{ "Size of '" + filename + "' is not a multiple of the table's arity" };
+        table.use_mapped_values(reinterpret_cast<const int32_t *>(contents.data()),
+                contents.size() / (table.arity() * sizeof(int32_t)), file);
+    }
+}
+
+auto read_model_from(string_view text, const string & directory) -> Model
+{
+    Tokenizer tokens{ text };
+    string_view word;
 
     Model model;
-    map<string, std::shared_ptr<Table> > tables;
-    map<string, VariableID> variable_name_to_id;
+    unordered_map<string_view, std::shared_ptr<Table> > tables;
+    vector<VariableValue> tuple;
+
+    // names point into the text. array elements don't get names of their
+    // own, and are looked up through the model instead.
+    unordered_map<string_view, VariableID> variable_name_to_id;
+    long long next_variable_id = 0;
+
+    // lots of variables tend to have the same domain
+    VariablePool variables;
 
-    auto make_name = [&] (const string & n) -> VariableID {
-        VariableID id{ int(variable_name_to_id.size()) };
-        if (! variable_name_to_id.emplace(n, id).second)
-            throw InputError{ "Duplicate variable '" + n + "'" };
+    auto make_name = [&] (string_view n) -> VariableID {
+        VariableID id{ int(next_variable_id++) };
+        if (model.find_variable(n) || ! variable_name_to_id.emplace(n, id).second)
+            throw tokens.error("Duplicate variable '" + string{ n } + "'");
         return id;
     };
 
-    auto get_name = [&] (const string & n) -> VariableID {
+    auto get_name = [&] (string_view n) -> VariableID {
         auto i = variable_name_to_id.find(n);
-        if (i == variable_name_to_id.end())
-            throw InputError{ "No variable named '" + n + "'" };
-        return i->second;
+        if (i != variable_name_to_id.end())
+            return i->second;
+        if (auto v = model.find_variable(n))
+            return *v;
+        throw tokens.error("No variable named '" + string{ n } + "'");
     };
 
-    while (infile >> word) {
+    auto bad_arguments = [&] () -> InputError {
+        return tokens.error("Bad arguments to '" + string{ word } + "' command");
+    };
+
+    while (tokens.next(word)) {
         if (word == "intvar") {
-            string name;
-            string op;
-            if (! (infile >> name >> op))
-                throw InputError{ "Bad arguments to '" + word + "' command" };
+            string_view name;
+            string_view op;
+            if (! (tokens.next(name) && tokens.next(op)))
+                throw bad_arguments();
             if (op == "{") {
-                string v;
+                string_view v;
                 set<int> values;
                 while (true) {
-                    if (! (infile >> v))
-                        throw InputError{ "Bad arguments to '" + word + "' command" };
+                    if (! tokens.next(v))
+                        throw bad_arguments();
                     if (v == "}")
                         break;
-                    stringstream ss{ v };
                     int val;
-                    if (! (ss >> val))
-                        throw InputError{ "Bad arguments to '" + word + "' command" };
+                    if (! parse_int(v, val))
+                        throw bad_arguments();
                     values.insert(val);
                 }
-                if (! model.add_variable(name, make_name(name), make_shared<Variable>(values)))
-                    throw InputError{ "Duplicate variable '" + name + "'" };
+                if (! model.add_variable(string{ name }, make_name(name), variables.make_variable(values)))
+                    throw tokens.error("Duplicate variable '" + string{ name } + "'");
             }
             else {
-                stringstream s{ op };
                 int lb, ub;
-                if (! (s >> lb) || ! (infile >> ub))
-                    throw InputError{ "Bad arguments to '" + word + "' command" };
-                if (! model.add_variable(name, make_name(name), make_shared<Variable>(lb, ub)))
-                    throw InputError{ "Duplicate variable '" + name + "'" };
+                if (! (parse_int(op, lb) && tokens.next(ub)))
+                    throw bad_arguments();
+                if (! model.add_variable(string{ name }, make_name(name), variables.make_variable(lb, ub)))
+                    throw tokens.error("Duplicate variable '" + string{ name } + "'");
             }
         }
         else if (word == "intvararray") {
-            string name;
+            string_view name;
             int dim;
-            int s1, e1, s2, e2;
             int lb, ub;
-            if (! (infile >> name >> dim))
-                throw InputError{ "Bad arguments to '" + word + "' command" };
-            if (dim != 2)
-                throw InputError{ "Bad arguments to '" + word + "' command: only dimension 2 supported out of sheer laziness" };
-            if (! (infile >> s1 >> e1 >> s2 >> e2 >> lb >> ub))
-                throw InputError{ "Bad arguments to '" + word + "' command" };
-            for (int i = s1 ; i <= e1 ; ++i)
-                for (int j = s2 ; j <= e2 ; ++j) {
-                    string full_name = name + "[" + to_string(i) + "," + to_string(j) + "]";
-                    if (! model.add_variable(full_name, make_name(full_name), make_shared<Variable>(lb, ub)))
-                        throw InputError{ "Duplicate variable '" + name + "'" };
-                }
+            if (! (tokens.next(name) && tokens.next(dim)) || dim < 1)
+                throw bad_arguments();
+
+            vector<pair<int, int> > index_ranges;
+            long long size = 1;
+            for (int d = 0 ; d < dim ; ++d) {
+                int start, end;
+                if (! (tokens.next(start) && tokens.next(end)))
+                    throw bad_arguments();
+                index_ranges.emplace_back(start, end);
+                size *= (end >= start ? (static_cast<long long>(end) - start + 1) : 0);
+                if (next_variable_id + size > numeric_limits<int>::max())
+                    throw tokens.error("Too many variables in '" + string{ name } + "'");
+            }
+
+            if (! (tokens.next(lb) && tokens.next(ub)))
+                throw bad_arguments();
+
+            if (! model.add_variable_array(string{ name }, VariableID{ int(next_variable_id) }, index_ranges, *variables.make_variable(lb, ub)))
+                throw tokens.error("Duplicate variable '" + string{ name } + "'");
+            next_variable_id += size;
         }
         else if (word == "notequal") {
-            string first, second;
-            if (! (infile >> first >> second))
-                throw InputError{ "Bad arguments to '" + word + "' command" };
+            string_view first, second;
+            if (! (tokens.next(first) && tokens.next(second)))
+                throw bad_arguments();
             model.add_constraint(make_shared<NotEqualConstraint>(get_name(first), get_name(second)));
         }
         else if (word == "equal") {
-            string first;
+            string_view first;
             int second;
-            if (! (infile >> first >> second))
-                throw InputError{ "Bad arguments to '" + word + "' command" };
+            if (! (tokens.next(first) && tokens.next(second)))
+                throw bad_arguments();
             model.add_constraint(make_shared<EqualConstantConstraint>(get_name(first), VariableValue{ second }));
         }
         else if (word == "createtable") {
-            string name;
+            string_view name;
             int arity;
-            if (! (infile >> name >> arity))
-                throw InputError{ "Bad arguments to '" + word + "' command" };
+            if (! (tokens.next(name) && tokens.next(arity)))
+                throw bad_arguments();
             if (! tables.emplace(name, make_shared<Table>(arity)).second)
-                throw InputError{ "Duplicate table '" + name + "'" };
+                throw tokens.error("Duplicate table '" + string{ name } + "'");
+        }
+        else if (word == "loadtable") {
+            string_view name, file;
+            int arity;
+            if (! (tokens.next(name) && tokens.next(arity) && tokens.next(file)))
+                throw bad_arguments();
+
+            // relative paths are relative to the model
+            string filename{ file };
+            if ('/' != filename[0])
+                filename = directory + filename;
+
+            auto table = make_shared<Table>(arity);
+            load_table(*table, filename);
+
+            if (! tables.emplace(name, table).second)
+                throw tokens.error("Duplicate table '" + string{ name } + "'");
         }
         else if (word == "addtotable") {
-            string name;
-            if (! (infile >> name))
-                throw InputError{ "Bad arguments to '" + word + "' command" };
+            string_view name;
+            if (! tokens.next(name))
+                throw bad_arguments();
             auto table = tables.find(name);
             if (table == tables.end())
-                throw InputError{ "No table named '" + name + "'" };
+                throw tokens.error("No table named '" + string{ name } + "'");
 
-            vector<VariableValue> tuple;
-            for (int i = 0 ; i < table->second->arity ; ++i) {
+            tuple.clear();
+            for (int i = 0 ; i < table->second->arity() ; ++i) {
                 int value;
-                if (! (infile >> value))
-                    throw InputError{ "Bad arguments to '" + word + "' command" };
+                if (! tokens.next(value))
+                    throw bad_arguments();
                 tuple.push_back(VariableValue{ value });
             }
-            table->second->allowed_tuples.push_back(move(tuple));
+            table->second->add_tuple(tuple);
         }
         else if (word == "table") {
-            string name;
-            if (! (infile >> name))
-                throw InputError{ "Bad arguments to '" + word + "' command" };
+            string_view name;
+            if (! tokens.next(name))
+                throw bad_arguments();
 
             auto table = tables.find(name);
             if (table == tables.end())
-                throw InputError{ "No table named '" + name + "'" };
+                throw tokens.error("No table named '" + string{ name } + "'");
 
             auto constraint = make_shared<TableConstraint>(table->second);
-            for (int i = 0 ; i < table->second->arity ; ++i) {
-                string name;
-                if (! (infile >> name))
-                    throw InputError{ "Bad arguments to '" + word + "' command" };
+            for (int i = 0 ; i < table->second->arity() ; ++i) {
+                string_view name;
+                if (! tokens.next(name))
+                    throw bad_arguments();
                 constraint->associate_with_variable(get_name(name));
             }
             model.add_constraint(constraint);
@@ -174,29 +346,110 @@ auto read_model(const string & filename) -> Model
                 strength = AllDifferentStrength::Matching;
 
             int number;
-            if (! (infile >> number))
-                throw InputError{ "Bad arguments to '" + word + "' command" };
+            if (! tokens.next(number))
+                throw bad_arguments();
 
             vector<VariableID> vars;
             for (int i = 0 ; i < number ; ++i) {
-                string var;
-                if (! (infile >> var))
-                    throw InputError{ "Bad arguments to '" + word + "' command" };
+                string_view var;
+                if (! tokens.next(var))
+                    throw bad_arguments();
                 vars.push_back(get_name(var));
             }
 
             auto constraint = make_shared<AllDifferentConstraint>(move(vars), strength);
             model.add_constraint(constraint);
         }
+        else if (word == "minimize" || word == "maximize") {
+            string_view name;
+            if (! tokens.next(name))
+                throw bad_arguments();
+            if (model.objective())
+                throw tokens.error("Duplicate objective");
+            model.set_objective(get_name(name), word == "minimize" ? ObjectiveDirection::Minimize : ObjectiveDirection::Maximize);
+        }
         else if (word == "#") {
-            string ignore;
-            getline(infile, ignore);
+            tokens.skip_line();
         }
         else {
-            throw InputError{ "Unknown command '" + word + "'" };
+            throw tokens.error("Unknown command '" + string{ word } + "'");
         }
     }
 
     return model;
-};
+}
+}
+
+auto read_model(const string & filename) -> Model
+{
+    auto file = make_shared<const MappedFile>(filename);
+    if (is_binary_model(file->contents()))
+        return read_binary_model(file);
+
+    auto slash = filename.rfind('/');
+    return read_model_from(file->contents(), string::npos == slash ? "" : filename.substr(0, slash + 1));
+}
+
+auto read_model(istream & infile) -> Model
+{
+    string text{ istreambuf_iterator<char>{ infile }, istreambuf_iterator<char>{ } };
+    return read_model_from(text, "");
+}
+
+auto read_hints(const string & filename, const Model & model) -> map<VariableID, VariableValue>
+{
+    ifstream infile{ filename };
+    if (! infile)
+        throw InputError{ "Error reading from '" + filename + "'" };
+
+    // hints use the same "name = value" format as our output, so a previous
+    // run can be fed back in directly. anything that isn't a variable is
+    // ignored.
+    map<VariableID, VariableValue> result;
+    string line;
+    while (getline(infile, line)) {
+        auto eq = line.find(" = ");
+        if (string::npos == eq)
+            continue;
 
+        auto var = model.find_variable(line.substr(0, eq));
+        if (! var)
+            continue;
+
+        stringstream ss{ line.substr(eq + 3) };
+        int val;
+        if (! (ss >> val))
+            throw InputError{ "Bad value for '" + line.substr(0, eq) + "' in hints" };
+        result.insert_or_assign(*var, VariableValue{ val });
+    }
+
+    return result;
+}
+
+auto read_clues(istream & infile, const Model & model) -> vector<pair<VariableID, VariableValue> >
+{
+    // clues can either be given in the same "name = value" format as our
+    // output, or as "equal name value" lines taken from a model
+    vector<pair<VariableID, VariableValue> > result;
+    string line;
+    while (getline(infile, line)) {
+        stringstream ss{ line };
+        string first, second, name;
+        int val;
+        if (! (ss >> first) || first[0] == '#')
+            continue;
+        else if (first == "equal" && ss >> name >> val)
+            ;
+        else if (ss >> second && second == "=" && ss >> val)
+            name = first;
+        else
+            throw InputError{ "Bad clue '" + line + "'" };
+
+        auto var = model.find_variable(name);
+        if (! var)
+            throw InputError{ "Unknown variable '" + name + "' in clues" };
+        result.emplace_back(*var, VariableValue{ val });
+    }
+
+    return result;
+}
@@ -4,9 +4,14 @@
 #define GLASGOW_CONSTRAINT_SOLVER_GUARD_SRC_READ_MODEL_HH 1
 
 #include "model-fwd.hh"
+#include "variable-fwd.hh"
 
 #include <exception>
+#include <iosfwd>
+#include <map>
 #include <string>
+#include <utility>
+#include <vector>
 
 class InputError : public std::exception
 {
@@ -21,4 +26,13 @@ class InputError : public std::exception
 
 auto read_model(const std::string & filename) -> Model;
 
+auto read_model(std::istream &) -> Model;
+
+auto read_hints(const std::string & filename, const Model & model) -> std::map<VariableID, VariableValue>;
+
+/**
+ * Read clues for an instance of a model template, one assignment per line.
+ */
+auto read_clues(std::istream &, const Model & model) -> std::vector<std::pair<VariableID, VariableValue> >;
+
 #endif
@@ -0,0 +1,73 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+#include "result.hh"
+#include "solve.hh"
+
+#include <iomanip>
+#include <ostream>
+
+using std::boolalpha;
+using std::endl;
+using std::ostream;
+
+using std::chrono::milliseconds;
+
+auto write_result(ostream & stream, const Result & result, const SolveOptions & options, milliseconds runtime) -> void
+{
+    stream << "status = ";
+    if (0 != result.solution_count)
+        stream << "true";
+    else if (result.aborted)
+        stream << "unknown";
+    else
+        stream << "false";
+    stream << endl;
+
+    if (result.aborted) {
+        stream << "aborted = ";
+        switch (*result.aborted) {
+            case SearchLimit::Time:   stream << "timeout"; break;
+            case SearchLimit::Nodes:  stream << "nodes"; break;
+            case SearchLimit::Memory: stream << "memory"; break;
+            case SearchLimit::Interrupted: stream << "interrupted"; break;
+        }
+        stream << endl;
+    }
+
+    if (options.all_solutions)
+        stream << "solutions = " << result.solution_count << endl;
+
+    if (result.objective_value) {
+        stream << "objective = " << *result.objective_value << endl;
+        stream << "optimal = " << boolalpha << result.optimal << endl;
+    }
+
+    if (! result.winning_configuration.empty())
+        stream << "portfolio_winner = " << result.winning_configuration << endl;
+
+    if (options.presolve) {
+        stream << "removed_by_presolve = " << result.removed_by_presolve << endl;
+        stream << "constraints_removed_by_presolve = " << result.constraints_removed_by_presolve << endl;
+        stream << "variables_eliminated_by_presolve = " << result.variables_eliminated_by_presolve << endl;
+    }
+
+    if (options.probe) {
+        stream << "probes = " << result.probes << endl;
+        stream << "removed_by_probing = " << result.removed_by_probing << endl;
+    }
+
+    if (0 != result.components)
+        stream << "components = " << result.components << endl;
+
+    if (0 != result.subproblems)
+        stream << "subproblems = " << result.subproblems << endl;
+
+    stream << "nodes = " << result.nodes << endl;
+    stream << "scratch_allocations = " << result.scratch_allocations << endl;
+    stream << "runtime = " << runtime.count() << endl;
+
+    if (! result.solution.empty()) {
+        for (auto & [ k, v ] : result.solution)
+            stream << k << " = " << v << endl;
+    }
+}
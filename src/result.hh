@@ -4,13 +4,68 @@
 #define GLASGOW_CONSTRAINT_SOLVER_GUARD_SRC_RESULT_HH 1
 
 #include "result-fwd.hh"
+#include "variable-fwd.hh"
+#include <chrono>
+#include <iosfwd>
 #include <string>
 #include <map>
+#include <optional>
+
+struct SolveOptions;
+
+enum class SearchLimit
+{
+    Time,
+    Nodes,
+    Memory,
+    Interrupted
+};
 
 struct Result
 {
     unsigned long long nodes = 0;
+    unsigned long long solution_count = 0;
+    unsigned long long subproblems = 0;
+    unsigned long long components = 0;
+
+    // from root probing, how many probes we made and how many values they
+    // removed
+    unsigned long long probes = 0;
+    unsigned long long removed_by_probing = 0;
+
+    // from presolving, how many values, constraints and variables went
+    unsigned long long removed_by_presolve = 0;
+    unsigned long long constraints_removed_by_presolve = 0;
+    unsigned long long variables_eliminated_by_presolve = 0;
+
     std::map<std::string, std::string> solution;
+
+    // the same solution, for when we have the model to hand and don't want
+    // to go through names and strings
+    std::map<VariableID, VariableValue> values;
+
+    // for optimisation problems, the best objective value found, and
+    // whether we showed it is optimal
+    std::optional<int> objective_value;
+    bool optimal = false;
+
+    // for a portfolio, which configuration gave us the answer
+    std::string winning_configuration;
+
+    // how many times propagation had to go to the heap for working memory,
+    // including the queue, on this solve's threads. this stops growing once
+    // every thread's scratch arena and pool are big enough, but the first
+    // solve on a thread still pays for getting them that big.
+    unsigned long long scratch_allocations = 0;
+
+    // if we gave up early, this says why
+    std::optional<SearchLimit> aborted;
 };
 
+/**
+ * Write out a result in our usual "key = value" format, finishing with the
+ * solution, if there is one.
+ */
+auto write_result(std::ostream &, const Result &, const SolveOptions &, std::chrono::milliseconds runtime) -> void;
+
 #endif
@@ -0,0 +1,155 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+#include "scratch.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <vector>
+
+using std::align_val_t;
+using std::max_align_t;
+using std::size_t;
+using std::uintptr_t;
+using std::unique_ptr;
+using std::vector;
+
+using std::pmr::memory_resource;
+using std::pmr::new_delete_resource;
+using std::pmr::pool_options;
+using std::pmr::unsynchronized_pool_resource;
+
+namespace
+{
+thread_local unsigned long long heap_allocations = 0;
+
+struct Overflow
+{
+    void * pointer;
+    size_t bytes;
+    size_t alignment;
+};
+
+class ScratchArena final : public memory_resource
+{
+    private:
+        unique_ptr<max_align_t[]> _buffer;
+        size_t _capacity = 0, _used = 0;
+
+        // anything that didn't fit, which we free at the end of the
+        // outermost scope
+        vector<Overflow> _overflow;
+        size_t _overflow_bytes = 0;
+
+        auto _grow(size_t capacity) -> void
+        {
+            ++heap_allocations;
+            _capacity = capacity;
+            _buffer.reset(new max_align_t[(_capacity + sizeof(max_align_t) - 1) / sizeof(max_align_t)]);
+        }
+
+    protected:
+        auto do_allocate(size_t bytes, size_t alignment) -> void * override
+        {
+            // this is enough for most propagators on most problems
+            if (! _buffer)
+                _grow(64 * 1024);
+
+            auto base = reinterpret_cast<uintptr_t>(_buffer.get());
+            auto start = (base + _used + alignment - 1) & ~(uintptr_t(alignment) - 1);
+            if (start + bytes <= base + _capacity) {
+                _used = start + bytes - base;
+                return reinterpret_cast<void *>(start);
+            }
+
+            ++heap_allocations;
+            auto result = ::operator new(bytes, align_val_t{ alignment });
+            _overflow.push_back(Overflow{ result, bytes, alignment });
+            _overflow_bytes += bytes + alignment;
+            return result;
+        }
+
+        auto do_deallocate(void *, size_t, size_t) -> void override
+        {
+        }
+
+        auto do_is_equal(const memory_resource & other) const noexcept -> bool override
+        {
+            return this == &other;
+        }
+
+    public:
+        auto reset() -> void
+        {
+            for (auto & o : _overflow)
+                ::operator delete(o.pointer, o.bytes, align_val_t{ o.alignment });
+            _overflow.clear();
+
+            // next time, everything should fit
+            if (0 != _overflow_bytes) {
+                _grow(2 * (_capacity + _overflow_bytes));
+                _overflow_bytes = 0;
+            }
+
+            _used = 0;
+        }
+};
+
+thread_local ScratchArena scratch_arena;
+thread_local int scratch_depth = 0;
+
+// counts what our pools get from the heap
+class CountingResource final : public memory_resource
+{
+    protected:
+        auto do_allocate(size_t bytes, size_t alignment) -> void * override
+        {
+            ++heap_allocations;
+            return new_delete_resource()->allocate(bytes, alignment);
+        }
+
+        auto do_deallocate(void * pointer, size_t bytes, size_t alignment) -> void override
+        {
+            new_delete_resource()->deallocate(pointer, bytes, alignment);
+        }
+
+        auto do_is_equal(const memory_resource & other) const noexcept -> bool override
+        {
+            return this == &other;
+        }
+};
+
+thread_local CountingResource counting_resource;
+
+// a queue has a vector as big as the number of constraints, so we want that
+// to come from the pool too, rather than going straight to the heap
+thread_local unsynchronized_pool_resource scratch_pool_resource{ pool_options{ 0, 1 << 22 }, &counting_resource };
+}
+
+ScratchScope::ScratchScope()
+{
+    ++scratch_depth;
+}
+
+ScratchScope::~ScratchScope()
+{
+    if (0 == --scratch_depth)
+        scratch_arena.reset();
+}
+
+auto ScratchScope::resource() const -> memory_resource *
+{
+    return &scratch_arena;
+}
+
+auto scratch_pool() -> memory_resource *
+{
+    return &scratch_pool_resource;
+}
+
+auto scratch_heap_allocations() -> unsigned long long
+{
+    return heap_allocations;
+}
@@ -0,0 +1,43 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+#ifndef CERTIFIED_CONSTRAINT_SOLVER_GUARD_SRC_SCRATCH_HH
+#define CERTIFIED_CONSTRAINT_SOLVER_GUARD_SRC_SCRATCH_HH 1
+
+#include <memory_resource>
+
+/**
+ * Working memory for propagators. Each thread has an arena, and containers
+ * using resource() allocate from it by bumping a pointer. Everything is
+ * thrown away at once when the outermost scope on the thread ends, so
+ * containers using the arena must not outlive their scope. If the arena
+ * had to go to the heap because it was too small, it grows to fit, and so
+ * once it has seen the biggest call, propagation stops allocating.
+ */
+class ScratchScope
+{
+    public:
+        ScratchScope();
+        ~ScratchScope();
+
+        ScratchScope(const ScratchScope &) = delete;
+        ScratchScope & operator= (const ScratchScope &) = delete;
+
+        auto resource() const -> std::pmr::memory_resource *;
+};
+
+/**
+ * Working memory which is given back and then wanted again over and over,
+ * like the queue during propagation. Each thread has its own pool, which
+ * keeps hold of anything given back to it and hands it out again next time.
+ */
+auto scratch_pool() -> std::pmr::memory_resource *;
+
+/**
+ * How many times the calling thread's arena and pool have had to allocate
+ * from the heap. This is kept for each thread separately, so that solves
+ * running at the same time don't count each other's allocations, and so a
+ * solve which starts threads of its own has to add their counts in itself.
+ */
+auto scratch_heap_allocations() -> unsigned long long;
+
+#endif
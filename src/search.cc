@@ -0,0 +1,356 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+#include "search.hh"
+#include "model.hh"
+#include "proof.hh"
+#include "result.hh"
+#include "variable.hh"
+
+#include <algorithm>
+#include <iomanip>
+#include <iterator>
+#include <string>
+
+#include <sys/resource.h>
+
+using std::endl;
+using std::find;
+using std::move;
+using std::next;
+using std::optional;
+using std::reverse;
+using std::rotate;
+using std::set;
+using std::shuffle;
+using std::string;
+using std::vector;
+
+using std::chrono::steady_clock;
+
+SearchState::SearchState(const SolveOptions & o, Result & r, optional<Proof> & p) :
+    options(o),
+    result(r),
+    proof(p),
+    random(o.random_seed),
+    phases(o.hints)
+{
+}
+
+auto order_values(SearchState & state, VariableID var, const Domain & values) -> vector<VariableValue>
+{
+    vector<VariableValue> result{ values.begin(), values.end() };
+
+    switch (state.options.value_ordering) {
+        case ValueOrdering::Min:
+        case ValueOrdering::PhaseSaving:
+            break;
+
+        case ValueOrdering::Max:
+            reverse(result.begin(), result.end());
+            break;
+
+        case ValueOrdering::Median: {
+            // start in the middle, and work outwards alternating below and above
+            vector<VariableValue> from_middle;
+            int below = (int(result.size()) - 1) / 2, above = below + 1;
+            while (below >= 0 || above < int(result.size())) {
+                if (below >= 0)
+                    from_middle.push_back(result[below--]);
+                if (above < int(result.size()))
+                    from_middle.push_back(result[above++]);
+            }
+            result = move(from_middle);
+            break;
+        }
+
+        case ValueOrdering::Random:
+            shuffle(result.begin(), result.end(), state.random);
+            break;
+    }
+
+    // a saved phase or a hint goes first, if it is still possible, and
+    // everything else stays in order
+    auto & preferences = (state.options.value_ordering == ValueOrdering::PhaseSaving) ? state.phases : state.options.hints;
+    auto preferred = preferences.find(var);
+    if (preferred != preferences.end()) {
+        auto p = find(result.begin(), result.end(), preferred->second);
+        if (p != result.end())
+            rotate(result.begin(), p, next(p));
+    }
+
+    return result;
+}
+
+namespace
+{
+auto peak_memory_usage_in_megabytes() -> unsigned long long
+{
+    struct rusage usage;
+    if (0 != getrusage(RUSAGE_SELF, &usage))
+        return 0;
+
+#ifdef __APPLE__
+    return usage.ru_maxrss / (1024 * 1024);
+#else
+    return usage.ru_maxrss / 1024;
+#endif
+}
+}
+
+// the node limit is exact, but time and memory are only looked at once in
+// this many calls
+const unsigned limit_polling_interval = 256;
+
+auto check_limits(SearchState & state) -> bool
+{
+    // someone else wants us to stop, but this isn't because of a limit
+    if (state.stop && *state.stop)
+        return false;
+
+    auto nodes = state.total_nodes ? state.total_nodes->load() : state.result.nodes;
+    if (state.options.interrupted && *state.options.interrupted)
+        state.result.aborted = SearchLimit::Interrupted;
+    else if (state.options.node_limit && nodes >= *state.options.node_limit)
+        state.result.aborted = SearchLimit::Nodes;
+    else if (state.checks_until_polled-- == 0) {
+        state.checks_until_polled = limit_polling_interval - 1;
+        if (state.deadline && steady_clock::now() >= *state.deadline)
+            state.result.aborted = SearchLimit::Time;
+        else if (state.options.memory_limit && peak_memory_usage_in_megabytes() >= *state.options.memory_limit)
+            state.result.aborted = SearchLimit::Memory;
+    }
+
+    return ! state.result.aborted;
+}
+
+namespace
+{
+auto log_solution(Proof & proof, const Model & model, const string & rule) -> void
+{
+    proof.proof_stream() << rule;
+    model.for_each_variable([&] (VariableID name, const Variable & v) {
+            proof.proof_stream() << " x" << proof.variable_value_mapping(name, *v.values.begin());
+            });
+    proof.proof_stream() << endl;
+    proof.next_proof_line();
+}
+
+auto discrepancy_allowed(const SearchState & state, int depth, int discrepancies) -> bool
+{
+    switch (state.options.search_mode) {
+        case SearchMode::DepthFirst:
+            return true;
+
+        case SearchMode::LimitedDiscrepancy:
+            return discrepancies <= state.discrepancy_limit;
+
+        case SearchMode::DepthBoundedDiscrepancy:
+            // rather than forcing a discrepancy at the limit depth, we revisit
+            // the heuristic path, which keeps the refutations we log for the
+            // proof complete
+            return discrepancies == 0 || depth < state.discrepancy_limit;
+    }
+
+    return true;
+}
+
+template <bool Proving_>
+auto propagate_node_with(int depth, SearchState & state, Model & model) -> bool
+{
+    auto & proof = state.proof;
+
+    if constexpr (Proving_) {
+        if (proof->comments(ProofComments::Full))
+            proof->proof_stream() << "* propagation at depth " << depth << endl;
+    }
+
+    // when optimising, we only care about solutions better than the best
+    // we, or anyone searching alongside us, have found so far
+    if (state.have_best && *state.have_best)
+        state.result.objective_value = state.best->load();
+
+    if (state.objective && state.result.objective_value) {
+        auto & [ objective_variable_name, direction ] = *state.objective;
+        auto & values = model.get_variable(objective_variable_name)->values;
+        VariableValue best{ *state.result.objective_value };
+        if (direction == ObjectiveDirection::Minimize)
+            values.erase(values.lower_bound(best), values.end());
+        else
+            values.erase(values.begin(), values.upper_bound(best));
+
+        if (values.empty()) {
+            if constexpr (Proving_)
+                if (proof->comments(ProofComments::Full))
+                    proof->proof_stream() << "* objective bound detected inconsistency at depth " << depth << endl;
+
+            return false;
+        }
+    }
+
+    if (! model.propagate(proof)) {
+        if constexpr (Proving_)
+            if (proof->comments(ProofComments::Full))
+                proof->proof_stream() << "* propagation detected inconsistency at depth " << depth << endl;
+
+        return false;
+    }
+
+    if (state.options.value_ordering == ValueOrdering::PhaseSaving)
+        model.for_each_variable([&] (VariableID name, const Variable & v) {
+                if (v.values.size() == 1)
+                    state.phases.insert_or_assign(name, *v.values.begin());
+                });
+
+    return true;
+}
+
+template <bool Proving_>
+auto found_solution_with(SearchState & state, const Model & model) -> SearchOutcome
+{
+    auto & proof = state.proof;
+
+    ++state.result.solution_count;
+
+    if (state.options.all_solutions) {
+        // tell the proof about the solution, which also excludes it
+        // from further consideration
+        if constexpr (Proving_) {
+            if (proof->comments(ProofComments::Minimal))
+                proof->proof_stream() << "* found solution " << state.result.solution_count << endl;
+            log_solution(*proof, model, "v");
+        }
+
+        if (state.options.on_solution)
+            state.options.on_solution(model);
+
+        return SearchOutcome::Exhausted;
+    }
+
+    if (state.objective) {
+        // remember this solution, and then carry on looking for a better one
+        auto value = *model.get_variable(state.objective->first)->values.begin();
+        state.result.objective_value = int{ value };
+        state.result.solution.clear();
+        state.result.values.clear();
+        model.save_result(state.result);
+
+        // tell the proof about the solution, which also says that we
+        // only want better solutions from now on
+        if constexpr (Proving_) {
+            if (proof->comments(ProofComments::Minimal))
+                proof->proof_stream() << "* found solution with objective value " << int{ value } << endl;
+            log_solution(*proof, model, "o");
+        }
+
+        if (state.options.on_solution)
+            state.options.on_solution(model);
+
+        return SearchOutcome::Exhausted;
+    }
+
+    model.save_result(state.result);
+    return SearchOutcome::Satisfied;
+}
+
+template <bool Proving_>
+auto search_with(int depth, int discrepancies, SearchState & state, const Model & start_model) -> SearchOutcome
+{
+    auto & proof = state.proof;
+
+    if (! check_limits(state))
+        return SearchOutcome::Aborted;
+
+    ++state.result.nodes;
+    if (state.total_nodes)
+        ++*state.total_nodes;
+
+    auto model = start_model;
+
+    if (! propagate_node_with<Proving_>(depth, state, model))
+        return SearchOutcome::Exhausted;
+
+    auto [ branch_variable_name, branch_variable ] = model.select_branch_variable(state.options.variable_ordering);
+    if (branch_variable) {
+        if constexpr (Proving_)
+            if (proof->comments(ProofComments::Full))
+                proof->proof_stream() << "* branching at depth " << depth << endl;
+
+        // the nth value in the ordering counts as n discrepancies, and
+        // anything we skip means this subtree has not been exhausted
+        bool skipped_values = false;
+        auto possible_values = order_values(state, branch_variable_name, branch_variable->values);
+        branch_variable->values.clear();
+        for (unsigned i = 0 ; i < possible_values.size() ; ++i) {
+            if (! discrepancy_allowed(state, depth, discrepancies + i)) {
+                skipped_values = true;
+                break;
+            }
+
+            branch_variable->values = {{ possible_values[i] }};
+
+            if constexpr (Proving_) {
+                if (proof->levels()) {
+                    proof->proof_stream() << "lvlset " << (depth + 2) << endl;
+                    proof->proof_stream() << "lvlclear " << (depth + 2) << endl;
+                }
+                proof->enstackinate_guess(branch_variable_name, model.original_name(branch_variable_name), possible_values[i]);
+            }
+
+            auto outcome = search_with<Proving_>(depth + 1, discrepancies + i, state, model);
+
+            if (SearchOutcome::Satisfied == outcome || SearchOutcome::Aborted == outcome)
+                return outcome;
+
+            if constexpr (Proving_) {
+                if (proof->levels())
+                    proof->proof_stream() << "lvlset " << (depth + 1) << endl;
+
+                // we can only claim a guess was wrong if we looked at
+                // everything underneath it
+                if (SearchOutcome::Exhausted == outcome)
+                    proof->incorrect_guess();
+                else
+                    proof->undo_guess();
+            }
+
+            if (SearchOutcome::Incomplete == outcome)
+                skipped_values = true;
+        }
+
+        if (skipped_values) {
+            if constexpr (Proving_)
+                if (proof->comments(ProofComments::Full))
+                    proof->proof_stream() << "* hit discrepancy limit at depth " << depth << endl;
+            return SearchOutcome::Incomplete;
+        }
+
+        if constexpr (Proving_)
+            if (proof->comments(ProofComments::Full))
+                proof->proof_stream() << "* ran out of branch values at depth " << depth << endl;
+
+        return SearchOutcome::Exhausted;
+    }
+    else
+        return found_solution_with<Proving_>(state, model);
+}
+}
+
+// the proof is either there or not for the whole search, so we decide once
+// which version to use, and the version without a proof has no proof
+// logging in it at all
+
+auto propagate_node(int depth, SearchState & state, Model & model) -> bool
+{
+    return state.proof ? propagate_node_with<true>(depth, state, model) : propagate_node_with<false>(depth, state, model);
+}
+
+auto found_solution(SearchState & state, const Model & model) -> SearchOutcome
+{
+    return state.proof ? found_solution_with<true>(state, model) : found_solution_with<false>(state, model);
+}
+
+auto search(int depth, int discrepancies, SearchState & state, const Model & start_model) -> SearchOutcome
+{
+    return state.proof ? search_with<true>(depth, discrepancies, state, start_model) :
+        search_with<false>(depth, discrepancies, state, start_model);
+}
@@ -0,0 +1,77 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+#ifndef CERTIFIED_CONSTRAINT_SOLVER_GUARD_SRC_SEARCH_HH
+#define CERTIFIED_CONSTRAINT_SOLVER_GUARD_SRC_SEARCH_HH 1
+
+#include "domain.hh"
+#include "model-fwd.hh"
+#include "model.hh"
+#include "proof-fwd.hh"
+#include "result-fwd.hh"
+#include "solve.hh"
+#include "variable-fwd.hh"
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <optional>
+#include <random>
+#include <set>
+#include <utility>
+#include <vector>
+
+enum class SearchOutcome
+{
+    Exhausted,
+    Incomplete,
+    Satisfied,
+    Aborted
+};
+
+struct SearchState
+{
+    const SolveOptions & options;
+    Result & result;
+    std::optional<Proof> & proof;
+    std::mt19937 random;
+
+    // for phase saving, the most recent value held by each variable
+    std::map<VariableID, VariableValue> phases;
+
+    // for discrepancy search, how far away from the value ordering we may go
+    int discrepancy_limit = 0;
+
+    // for optimisation, the variable we care about
+    std::optional<std::pair<VariableID, ObjectiveDirection> > objective;
+
+    // when we have to give up
+    std::optional<std::chrono::steady_clock::time_point> deadline;
+
+    // looking at the clock and at memory use is too expensive to do at
+    // every node, so we only do it every so often
+    unsigned checks_until_polled = 0;
+
+    // if several searches are running at once, the node limit applies to
+    // their total, and any one of them can tell the others to stop
+    std::atomic<unsigned long long> * total_nodes = nullptr;
+    const std::atomic<bool> * stop = nullptr;
+
+    // when optimising, the best value any of them has found, which each uses
+    // as its own bound
+    const std::atomic<bool> * have_best = nullptr;
+    const std::atomic<int> * best = nullptr;
+
+    SearchState(const SolveOptions &, Result &, std::optional<Proof> &);
+};
+
+auto order_values(SearchState &, VariableID, const Domain &) -> std::vector<VariableValue>;
+
+[[ nodiscard ]] auto check_limits(SearchState &) -> bool;
+
+[[ nodiscard ]] auto propagate_node(int depth, SearchState &, Model &) -> bool;
+
+auto found_solution(SearchState &, const Model &) -> SearchOutcome;
+
+auto search(int depth, int discrepancies, SearchState &, const Model &) -> SearchOutcome;
+
+#endif
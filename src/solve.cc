@@ -1,93 +1,134 @@
 /* vim: set sw=4 sts=4 et foldmethod=syntax : */
 
 #include "solve.hh"
+#include "components.hh"
 #include "model.hh"
-#include "constraint.hh"
+#include "parallel_search.hh"
+#include "presolve.hh"
+#include "probing.hh"
 #include "proof.hh"
 #include "result.hh"
+#include "scratch.hh"
+#include "search.hh"
 #include "variable.hh"
 
+#include <chrono>
 #include <iomanip>
-#include <list>
-#include <set>
-#include <utility>
+#include <optional>
+#include <string>
 
 using std::endl;
-using std::list;
 using std::optional;
-using std::pair;
-using std::set;
-using std::string;
+using std::to_string;
 
-auto search(int depth, Result & result, const Model & start_model, optional<Proof> & proof) -> void
-{
-    ++result.nodes;
-    auto model = start_model;
+using std::chrono::steady_clock;
 
+auto solve(const Model & model, optional<Proof> & proof, const SolveOptions & options) -> Result
+{
     if (proof) {
-        proof->proof_stream() << "* propagation at depth " << depth << endl;
+        model.start_proof(*proof);
     }
 
-    if (! model.propagate(proof)) {
-        if (proof)
-            proof->proof_stream() << "* propagation detected inconsistency at depth " << depth << endl;
-
-        return;
-    }
+    Result result;
+    auto scratch_allocations_before = scratch_heap_allocations();
+    SearchState state{ options, result, proof };
+    state.objective = model.objective();
+    if (options.timeout)
+        state.deadline = steady_clock::now() + *options.timeout;
+
+    // an assumption that conflicts with an earlier one, or that is outside
+    // the domain altogether, just means there are no solutions, the same as
+    // if it had been a constraint in the model
+    Model assumed_model = model;
+    bool assumptions_hold = true;
+    for (auto & [ var, val ] : options.assumptions) {
+        if (! model.get_variable(var)->values.count(val)) {
+            // the proof has no literal for this value, so we can't write
+            // anything saying why the assumptions fail
+            if (proof)
+                throw ProofError{ "Assumption " + model.original_name(var) + "=" + to_string(int{ val })
+                    + " is not in the domain, and so cannot be refuted in the proof" };
+            assumptions_hold = false;
+            break;
+        }
 
-    auto [ branch_variable_name, branch_variable ] = model.select_branch_variable();
-    if (branch_variable) {
+        // a conflicting guess is refuted by the variable taking at most one
+        // value, so this still gives the right clause at the end
         if (proof)
-            proof->proof_stream() << "* branching at depth " << depth << endl;
-
-        auto possible_values = branch_variable->values;
-        branch_variable->values.clear();
-        for (auto & v : possible_values) {
-            branch_variable->values = {{ v }};
-
-            if (proof) {
-                if (proof->levels()) {
-                    proof->proof_stream() << "lvlset " << (depth + 2) << endl;
-                    proof->proof_stream() << "lvlclear " << (depth + 2) << endl;
-                }
-                proof->enstackinate_guess(branch_variable_name, model.original_name(branch_variable_name), v);
-            }
+            proof->enstackinate_guess(var, model.original_name(var), val);
 
-            search(depth + 1, result, model, proof);
-
-            if (! result.solution.empty())
-                return;
-
-            if (proof) {
-                if (proof->levels())
-                    proof->proof_stream() << "lvlset " << (depth + 1) << endl;
-                proof->incorrect_guess();
-            }
+        auto & values = assumed_model.get_variable(var)->values;
+        if (! values.count(val)) {
+            assumptions_hold = false;
+            break;
         }
-
-        if (proof)
-            proof->proof_stream() << "* ran out of branch values at depth " << depth << endl;
+        values = {{ val }};
     }
-    else
-        model.save_result(result);
-};
 
-auto solve(const Model & model, optional<Proof> & proof) -> Result
-{
-    if (proof) {
-        model.start_proof(*proof);
+    int depth = options.assumptions.size();
+    SearchOutcome outcome = SearchOutcome::Incomplete;
+    if (! assumptions_hold) {
+        if (proof && proof->comments(ProofComments::Minimal))
+            proof->proof_stream() << "* assumptions conflict" << endl;
+        outcome = SearchOutcome::Exhausted;
+    }
+    else if (options.presolve && ! presolve(assumed_model, proof, result)) {
+        if (proof && proof->comments(ProofComments::Minimal))
+            proof->proof_stream() << "* presolve detected inconsistency" << endl;
+        outcome = SearchOutcome::Exhausted;
+    }
+    else if (options.probe && ! probe_at_root(assumed_model, options, proof, result, state.deadline)) {
+        if (proof && proof->comments(ProofComments::Minimal))
+            proof->proof_stream() << "* probing detected inconsistency" << endl;
+        outcome = SearchOutcome::Exhausted;
+    }
+    else switch (options.search_mode) {
+        case SearchMode::DepthFirst:
+            if (options.components && ! proof)
+                outcome = component_search(assumed_model, options, state.deadline, result);
+            else if (options.parallel_mode == ParallelMode::Decomposition && ! proof)
+                outcome = decomposition_search(assumed_model, options, state.deadline, result);
+            else if (options.parallel_mode == ParallelMode::Portfolio && ! proof)
+                outcome = portfolio_search(assumed_model, options, state.deadline, result);
+            else if (options.threads > 1 && ! proof)
+                outcome = parallel_search(assumed_model, options, state.deadline, result);
+            else
+                outcome = search(depth, 0, state, assumed_model);
+            break;
+
+        case SearchMode::LimitedDiscrepancy:
+        case SearchMode::DepthBoundedDiscrepancy:
+            // keep increasing the limit until we find a solution, or until an
+            // iteration manages to explore the entire tree
+            for ( ; ; ++state.discrepancy_limit) {
+                if (proof && proof->comments(ProofComments::Minimal))
+                    proof->proof_stream() << "* discrepancy search iteration " << state.discrepancy_limit << endl;
+
+                outcome = search(depth, 0, state, assumed_model);
+                if (SearchOutcome::Incomplete != outcome)
+                    break;
+            }
+            break;
     }
 
-    Result result;
+    if (proof && SearchOutcome::Aborted == outcome && proof->comments(ProofComments::Minimal))
+        proof->proof_stream() << "* search aborted, proof is incomplete" << endl;
 
-    search(0, result, model, proof);
+    if (result.objective_value && SearchOutcome::Exhausted == outcome)
+        result.optimal = true;
 
-    if (proof && result.solution.empty()) {
+    // if we have looked at everything, the proof can be finished off. when
+    // enumerating or optimising, every solution has already been excluded by
+    // this point.
+    if (proof && SearchOutcome::Exhausted == outcome && ! options.assumptions.empty())
+        proof->incorrect_guess();
+    else if (proof && SearchOutcome::Exhausted == outcome) {
         proof->proof_stream() << "u >= 1 ;" << endl;
         proof->next_proof_line();
         proof->proof_stream() << "c " << proof->last_proof_line() << " 0" << endl;
     }
 
+    // any threads we started have already added in their own counts
+    result.scratch_allocations += scratch_heap_allocations() - scratch_allocations_before;
     return result;
 }
-
@@ -3,12 +3,102 @@
 #ifndef GLASGOW_CONSTRAINT_SOLVER_GUARD_SRC_SOLVE_HH
 #define GLASGOW_CONSTRAINT_SOLVER_GUARD_SRC_SOLVE_HH 1
 
-#include "model-fwd.hh"
+#include "model.hh"
 #include "result-fwd.hh"
 #include "proof-fwd.hh"
+#include "variable-fwd.hh"
 
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <map>
 #include <optional>
+#include <utility>
+#include <vector>
 
-auto solve(const Model & model, std::optional<Proof> & proof) -> Result;
+enum class ValueOrdering
+{
+    Min,
+    Max,
+    Median,
+    Random,
+    PhaseSaving
+};
+
+enum class SearchMode
+{
+    DepthFirst,
+    LimitedDiscrepancy,
+    DepthBoundedDiscrepancy
+};
+
+enum class ParallelMode
+{
+    WorkStealing,
+    Decomposition,
+    Portfolio
+};
+
+struct SolveOptions
+{
+    SearchMode search_mode = SearchMode::DepthFirst;
+    VariableOrdering variable_ordering = VariableOrdering::SmallestDomain;
+    ValueOrdering value_ordering = ValueOrdering::Min;
+    unsigned random_seed = 0;
+
+    // values to try first when branching, for example from a previous
+    // solution to a similar instance
+    std::map<VariableID, VariableValue> hints;
+
+    // find every solution rather than stopping at the first, calling
+    // on_solution (if set) for each one rather than saving it. only valid
+    // for depth-first search.
+    bool all_solutions = false;
+    std::function<auto (const Model &) -> void> on_solution;
+
+    // give up if any of these are reached. the memory limit is on peak
+    // resident set size, in megabytes.
+    std::optional<std::chrono::milliseconds> timeout;
+    std::optional<unsigned long long> node_limit;
+    std::optional<unsigned long long> memory_limit;
+
+    // give up if this becomes true, which it can do from a signal handler
+    const std::atomic<bool> * interrupted = nullptr;
+
+    // solve under these assumptions, which the proof treats as guesses. if
+    // there are no solutions, the proof ends by showing that the assumptions
+    // cannot all hold, rather than by deriving a contradiction. assumptions
+    // which conflict, or which are outside a variable's domain, have no
+    // solutions.
+    std::vector<std::pair<VariableID, VariableValue> > assumptions;
+
+    // use this many threads for depth-first search. this is ignored for
+    // discrepancy search, and when producing a proof.
+    unsigned threads = 1;
+
+    // how to share work between threads. decomposition splits the problem up
+    // front into about subproblems_per_thread subproblems for each thread,
+    // and gives the same answer every time it is run. a portfolio runs a
+    // differently configured search on each thread, and the first to finish
+    // wins.
+    ParallelMode parallel_mode = ParallelMode::WorkStealing;
+    unsigned subproblems_per_thread = 30;
+
+    // before searching, propagate at the root, remove entailed and redundant
+    // constraints, and hide fixed variables which are left unconstrained
+    bool presolve = false;
+
+    // before searching, remove every value whose assignment fails under
+    // propagation, repeating until nothing changes. probes are shared out
+    // between threads, even when producing a proof.
+    bool probe = false;
+
+    // after propagating at the root, solve groups of variables that share no
+    // constraints separately, sharing them out between threads. only valid
+    // for depth-first search when not enumerating or producing a proof.
+    bool components = false;
+};
+
+auto solve(const Model & model, std::optional<Proof> & proof, const SolveOptions & options = SolveOptions{ }) -> Result;
 
 #endif
@@ -0,0 +1,110 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+#include "solver.hh"
+#include "model.hh"
+#include "proof.hh"
+#include "variable.hh"
+
+#include <deque>
+#include <memory>
+#include <optional>
+#include <string>
+
+using std::deque;
+using std::make_unique;
+using std::nullopt;
+using std::optional;
+using std::string;
+
+struct Solver::Imp
+{
+    Model original;
+    SolveOptions options;
+
+    // the propagated model at each level, or nothing if propagation failed
+    // at or above that level
+    deque<optional<Model> > levels;
+
+    Imp(const Model & m, const SolveOptions & o) :
+        original(m),
+        options(o)
+    {
+    }
+};
+
+Solver::Solver(const Model & model, const SolveOptions & options) :
+    _imp(make_unique<Imp>(model, options))
+{
+    optional<Proof> no_proof;
+    Model root = model;
+    if (root.propagate(no_proof))
+        _imp->levels.emplace_back(root);
+    else
+        _imp->levels.emplace_back(nullopt);
+}
+
+Solver::~Solver() = default;
+
+auto Solver::push(VariableID var, VariableValue val) -> bool
+{
+    auto & top = _imp->levels.back();
+    if (! top) {
+        _imp->levels.emplace_back(nullopt);
+        return false;
+    }
+
+    // the value could have been removed by propagating earlier assumptions,
+    // or might never have been in the domain at all
+    auto & values = top->get_variable(var)->values;
+    if (! values.count(val)) {
+        _imp->levels.emplace_back(nullopt);
+        return false;
+    }
+
+    Model child = *top;
+    child.get_variable(var)->values = {{ val }};
+
+    optional<Proof> no_proof;
+    if (child.propagate(no_proof)) {
+        _imp->levels.emplace_back(child);
+        return true;
+    }
+    else {
+        _imp->levels.emplace_back(nullopt);
+        return false;
+    }
+}
+
+auto Solver::pop() -> void
+{
+    if (_imp->levels.size() <= 1)
+        throw ModelError{ "Cannot pop an assumption when none have been pushed" };
+    _imp->levels.pop_back();
+}
+
+auto Solver::depth() const -> unsigned
+{
+    return _imp->levels.size() - 1;
+}
+
+auto Solver::solve() -> Result
+{
+    auto & top = _imp->levels.back();
+    if (! top)
+        return Result{ };
+
+    optional<Proof> no_proof;
+    auto result = ::solve(*top, no_proof, _imp->options);
+
+    // start the next query from this solution, which is likely to be close
+    // to the next one if the assumptions have only changed a little
+    for (auto & [ var, value ] : result.values)
+        _imp->options.hints.insert_or_assign(var, value);
+
+    return result;
+}
+
+auto Solver::model() const -> const Model &
+{
+    return _imp->original;
+}
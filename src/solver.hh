@@ -0,0 +1,56 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+#ifndef CERTIFIED_CONSTRAINT_SOLVER_GUARD_SRC_SOLVER_HH
+#define CERTIFIED_CONSTRAINT_SOLVER_GUARD_SRC_SOLVER_HH 1
+
+#include "model-fwd.hh"
+#include "result.hh"
+#include "solve.hh"
+#include "variable-fwd.hh"
+
+#include <memory>
+
+/**
+ * For using the solver as a library: answers a series of queries about the
+ * same model, each under whatever assumptions are currently pushed.
+ *
+ * The model is propagated once, when the solver is created, and again only
+ * when an assumption is pushed, with each level being kept until it is
+ * popped. Each query starts from the propagated model for the current level,
+ * and tries the values from the most recent solution first. Proof logging is
+ * not available.
+ */
+class Solver
+{
+    private:
+        struct Imp;
+        std::unique_ptr<Imp> _imp;
+
+    public:
+        explicit Solver(const Model &, const SolveOptions & = SolveOptions{ });
+        Solver(const Solver &) = delete;
+        ~Solver();
+
+        auto operator= (const Solver &) -> Solver & = delete;
+
+        /**
+         * Assume that a variable takes a value, until the matching pop().
+         * Returns false if the value is not in the variable's domain, or if
+         * this, together with everything already assumed, can be seen to be
+         * unsatisfiable just by propagation.
+         */
+        auto push(VariableID, VariableValue) -> bool;
+
+        auto pop() -> void;
+
+        /**
+         * How many assumptions are currently pushed.
+         */
+        auto depth() const -> unsigned;
+
+        auto solve() -> Result;
+
+        auto model() const -> const Model &;
+};
+
+#endif
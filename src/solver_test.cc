@@ -0,0 +1,109 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+// checks the Solver class through the library interface, the same way as
+// something outside of this project would use it. run by run-tests.bash.
+
+#include "all_different_constraint.hh"
+#include "model.hh"
+#include "result.hh"
+#include "solver.hh"
+#include "variable.hh"
+
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+using std::cerr;
+using std::endl;
+using std::make_shared;
+using std::set;
+using std::string;
+using std::to_string;
+using std::vector;
+
+namespace
+{
+auto failures = 0;
+
+auto check(bool condition, const string & what) -> void
+{
+    if (! condition) {
+        cerr << "solver test failed: " << what << endl;
+        ++failures;
+    }
+}
+
+// every variable has a value, and they are all different
+auto check_solution(const Result & result, const string & what) -> void
+{
+    check(result.values.size() == 3, what + " has a value for every variable");
+    set<VariableValue> seen;
+    for (auto & [ var, value ] : result.values) {
+        seen.insert(value);
+        check(result.solution.at("x" + to_string(int{ var })) == to_string(int{ value }), what + " agrees with the names");
+    }
+    check(seen.size() == 3, what + " satisfies alldifferent");
+}
+}
+
+auto main(int, char *[]) -> int
+{
+    Model model;
+    for (int i = 0 ; i < 3 ; ++i)
+        if (! model.add_variable("x" + to_string(i), VariableID{ i }, make_shared<Variable>(1, 3)))
+            throw ModelError{ "duplicate variable" };
+    model.add_constraint(make_shared<AllDifferentConstraint>(
+                vector{ VariableID{ 0 }, VariableID{ 1 }, VariableID{ 2 } }, AllDifferentStrength::GAC));
+
+    Solver solver{ model };
+    check(0 == solver.depth(), "starts with nothing pushed");
+
+    check(solver.push(VariableID{ 0 }, VariableValue{ 3 }), "push x0=3");
+    check(1 == solver.depth(), "depth after one push");
+    auto first = solver.solve();
+    check_solution(first, "solution under x0=3");
+    check(first.values.at(VariableID{ 0 }) == VariableValue{ 3 }, "solution respects x0=3");
+
+    // propagation has already taken 3 away from x1
+    check(! solver.push(VariableID{ 1 }, VariableValue{ 3 }), "push x1=3 fails");
+    check(2 == solver.depth(), "a failed push still needs popping");
+    check(solver.solve().values.empty(), "no solution under a failed push");
+    solver.pop();
+
+    check(! solver.push(VariableID{ 1 }, VariableValue{ 7 }), "push outside the domain fails");
+    solver.pop();
+
+    // with nothing assumed, the previous solution is tried first, and so is
+    // found again straight away
+    solver.pop();
+    check(0 == solver.depth(), "depth after popping everything");
+    auto again = solver.solve();
+    check_solution(again, "solution with no assumptions");
+    check(again.values == first.values, "previous solution is reused as a hint");
+
+    bool threw = false;
+    try {
+        solver.pop();
+    }
+    catch (const ModelError &) {
+        threw = true;
+    }
+    check(threw, "popping with nothing pushed throws");
+
+    // array elements are stored together, but each copy of a model still
+    // gets its own
+    Model with_array;
+    check(with_array.add_variable_array("y", VariableID{ 10 }, { { 1, 2 }, { 1, 3 } }, Variable{ 1, 4 }), "add an array");
+    check(! with_array.add_variable("z", VariableID{ 12 }, make_shared<Variable>(1, 4)), "array identifiers are taken");
+    check(with_array.find_variable("y[2,1]") == VariableID{ 13 }, "array elements are found by name");
+    Model copy{ with_array };
+    copy.get_variable(VariableID{ 13 })->values.erase(VariableValue{ 2 });
+    check(3 == copy.get_variable(VariableID{ 13 })->values.size(), "copy changed");
+    check(4 == with_array.get_variable(VariableID{ 13 })->values.size(), "original unchanged");
+    check(4 == copy.get_variable(VariableID{ 14 })->values.size(), "other elements unchanged");
+
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
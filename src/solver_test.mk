@@ -0,0 +1,12 @@
+TARGET := solver_test
+
+SOURCES := \
+    solver_test.cc
+
+TGT_PREREQS := libcertified_constraint_solver.a
+
+ifeq ($(shell uname -s), Linux)
+TGT_LDLIBS := libcertified_constraint_solver.a $(boost_ldlibs) -lstdc++fs
+else
+TGT_LDLIBS := libcertified_constraint_solver.a $(boost_ldlibs)
+endif
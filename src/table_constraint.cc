@@ -1,24 +1,75 @@
 /* vim: set sw=4 sts=4 et foldmethod=syntax : */
 
 #include "table_constraint.hh"
+#include "binary_model.hh"
 #include "model.hh"
 #include "variable.hh"
 #include "proof.hh"
+#include "mapped_file.hh"
 
 #include <iomanip>
 #include <ostream>
 
 using std::endl;
+using std::int32_t;
 using std::optional;
 using std::shared_ptr;
 using std::set;
+using std::size_t;
 using std::string;
 using std::to_string;
 using std::vector;
 
+namespace pmr = std::pmr;
+
 Table::Table(int a) :
-    arity(a)
+    _arity(a)
+{
+}
+
+auto Table::arity() const -> int
+{
+    return _arity;
+}
+
+auto Table::add_tuple(const vector<VariableValue> & tuple) -> void
+{
+    // we can't add to a mapped file, so the table has to become our own
+    if (_external_values) {
+        _owned_values.assign(_external_values, _external_values + _external_size);
+        _external_values = nullptr;
+        _external_size = 0;
+        _mapping.reset();
+    }
+
+    for (auto & v : tuple)
+        _owned_values.push_back(int{ v });
+}
+
+auto Table::use_mapped_values(const int32_t * values, size_t number_of_tuples, const shared_ptr<const MappedFile> & mapping) -> void
+{
+    _owned_values.clear();
+    _owned_values.shrink_to_fit();
+    _external_values = values;
+    _external_size = number_of_tuples * _arity;
+    _mapping = mapping;
+}
+
+auto Table::number_of_tuples() const -> size_t
+{
+    if (0 == _arity)
+        return 0;
+    return (_external_values ? _external_size : _owned_values.size()) / _arity;
+}
+
+auto Table::value(size_t tuple, int position) const -> VariableValue
+{
+    return VariableValue{ values()[tuple * _arity + position] };
+}
+
+auto Table::values() const -> const int32_t *
 {
+    return _external_values ? _external_values : _owned_values.data();
 }
 
 TableConstraint::TableConstraint(const shared_ptr<const Table> & t) :
@@ -33,17 +84,17 @@ auto TableConstraint::associate_with_variable(VariableID n) -> void
     _vars.push_back(n);
 }
 
-auto TableConstraint::propagate(Model & model, optional<Proof> &, set<VariableID> &) const -> bool
+auto TableConstraint::propagate(Model & model, optional<Proof> &, pmr::set<VariableID> &) const -> bool
 {
-    if (unsigned(_table->arity) != _vars.size())
+    if (unsigned(_table->arity()) != _vars.size())
         throw ModelError{ "Wrong number of variables in table constraint" };
 
-    for (auto & a : _table->allowed_tuples) {
+    for (size_t t = 0, t_end = _table->number_of_tuples() ; t != t_end ; ++t) {
         bool ok = true;
 
-        for (int i = 0 ; i < _table->arity ; ++i) {
+        for (int i = 0 ; i < _table->arity() ; ++i) {
             auto v = model.get_variable(_vars[i]);
-            if (! v->values.count(a[i])) {
+            if (! v->values.count(_table->value(t, i))) {
                 ok = false;
                 break;
             }
@@ -64,10 +115,10 @@ auto TableConstraint::start_proof(const Model & model, Proof & proof) -> void
     // variable, and either it is selected, or its control variable is
     // selected.
     vector<UnderlyingVariableID> controls;
-    for (unsigned t = 0 ; t < _table->allowed_tuples.size() ; ++t) {
+    for (size_t t = 0, t_end = _table->number_of_tuples() ; t != t_end ; ++t) {
         bool is_feasible = true;
-        for (int i = 0 ; i < _table->arity ; ++i)
-            if (! model.get_variable(_vars[i])->original_values->count(_table->allowed_tuples[t][i])) {
+        for (int i = 0 ; i < _table->arity() ; ++i)
+            if (! model.get_variable(_vars[i])->original_values->count(_table->value(t, i))) {
                 is_feasible = false;
                 break;
             }
@@ -79,10 +130,10 @@ auto TableConstraint::start_proof(const Model & model, Proof & proof) -> void
         UnderlyingVariableID control_idx = proof.create_anonymous_extra_variable();
         controls.push_back(control_idx);
 
-        proof.model_stream() << _table->arity << " x" << control_idx;
-        for (int i = 0 ; i < _table->arity ; ++i)
-            proof.model_stream() << " 1 x" << proof.variable_value_mapping(_vars[i], _table->allowed_tuples[t][i]);
-        proof.model_stream() << " >= " << _table->arity << " ;" << endl;
+        proof.model_stream() << _table->arity() << " x" << control_idx;
+        for (int i = 0 ; i < _table->arity() ; ++i)
+            proof.model_stream() << " 1 x" << proof.variable_value_mapping(_vars[i], _table->value(t, i));
+        proof.model_stream() << " >= " << _table->arity() << " ;" << endl;
         proof.next_model_line();
         _constraint_for_tuple.emplace(t, proof.last_model_line());
     }
@@ -110,3 +161,32 @@ auto TableConstraint::priority() const -> int
     return 2;
 }
 
+auto TableConstraint::write_binary(BinaryModelWriter & writer) const -> void
+{
+    writer.start_constraint(BinaryConstraintKind::Table);
+    writer.write_table(_table);
+    writer.write_variables(_vars);
+}
+
+auto TableConstraint::entailed(const Model & model) const -> bool
+{
+    // we only bother spotting the easy case, where everything is fixed to a
+    // tuple that is in the table
+    vector<VariableValue> fixed;
+    for (auto & v : _vars) {
+        auto & values = model.get_variable(v)->values;
+        if (values.size() != 1)
+            return false;
+        fixed.push_back(*values.begin());
+    }
+
+    for (size_t t = 0 ; t < _table->number_of_tuples() ; ++t) {
+        bool matches = true;
+        for (int i = 0 ; i < _arity && matches ; ++i)
+            matches = _table->value(t, i) == fixed[i];
+        if (matches)
+            return true;
+    }
+
+    return false;
+}
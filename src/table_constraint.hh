@@ -5,19 +5,57 @@
 
 #include "constraint.hh"
 
+#include <cstddef>
+#include <cstdint>
 #include <map>
 #include <memory>
 #include <vector>
 
-struct Table
+class MappedFile;
+
+/**
+ * The allowed tuples for a table constraint, stored one after another in a
+ * single flat block. Usually the table owns this storage, but it can instead
+ * point into a mapped file, to avoid copying large tables.
+ */
+class Table
 {
-    explicit Table(int a);
+    private:
+        int _arity;
+        std::vector<std::int32_t> _owned_values;
+        const std::int32_t * _external_values = nullptr;
+        std::size_t _external_size = 0;
+        std::shared_ptr<const MappedFile> _mapping;
+
+    public:
+        explicit Table(int a);
+
+        auto arity() const -> int;
 
-    int arity;
-    std::vector<std::vector<VariableValue> > allowed_tuples;
+        /**
+         * Add a tuple at the end. If we were using mapped values, they are
+         * copied first, and the mapping is no longer needed.
+         */
+        auto add_tuple(const std::vector<VariableValue> &) -> void;
+
+        /**
+         * Use values from somewhere else, which must stay put for as long as
+         * mapping is alive. Any tuples already added are discarded.
+         */
+        auto use_mapped_values(const std::int32_t * values, std::size_t number_of_tuples,
+                const std::shared_ptr<const MappedFile> & mapping) -> void;
+
+        auto number_of_tuples() const -> std::size_t;
+
+        auto value(std::size_t tuple, int position) const -> VariableValue;
+
+        /**
+         * Every value, as number_of_tuples() * arity() contiguous integers.
+         */
+        auto values() const -> const std::int32_t *;
 };
 
-class TableConstraint : public Constraint
+class TableConstraint final : public Constraint
 {
     private:
         int _arity;
@@ -33,13 +71,17 @@ class TableConstraint : public Constraint
 
         auto associate_with_variable(VariableID) -> void;
 
-        virtual auto propagate(Model & model, std::optional<Proof> &, std::set<VariableID> &) const -> bool override;
+        virtual auto propagate(Model & model, std::optional<Proof> &, std::pmr::set<VariableID> &) const -> bool override;
 
         virtual auto start_proof(const Model &, Proof &) -> void override;
 
         virtual auto associated_variables() const -> std::set<VariableID> override;
 
         virtual auto priority() const -> int override;
+
+        virtual auto write_binary(BinaryModelWriter &) const -> void override;
+
+        virtual auto entailed(const Model &) const -> bool override;
 };
 
 #endif
@@ -14,24 +14,42 @@ using std::make_shared;
 using std::ostream;
 using std::pair;
 using std::set;
+using std::shared_ptr;
 using std::string;
 
-Variable::Variable(int lw, int ub)
+namespace
+{
+auto make_values(int lw, int ub) -> shared_ptr<set<VariableValue> >
 {
     auto v = make_shared<set<VariableValue> >();
     for ( ; lw <= ub ; ++lw)
-        v->insert(VariableValue{ lw });
-    original_values = v;
-    values = *v;
+        v->insert(v->end(), VariableValue{ lw });
+    return v;
 }
 
-Variable::Variable(const set<int> & r)
+auto make_values(const set<int> & r) -> shared_ptr<set<VariableValue> >
 {
     auto v = make_shared<set<VariableValue> >();
     for (auto & w : r)
-        v->insert(VariableValue{ w });
-    original_values = v;
-    values = *v;
+        v->insert(v->end(), VariableValue{ w });
+    return v;
+}
+}
+
+Variable::Variable(const shared_ptr<set<VariableValue> > & v) :
+    original_values(v),
+    values(v)
+{
+}
+
+Variable::Variable(int lw, int ub) :
+    Variable(make_values(lw, ub))
+{
+}
+
+Variable::Variable(const set<int> & r) :
+    Variable(make_values(r))
+{
 }
 
 Variable::~Variable() = default;
@@ -67,3 +85,19 @@ auto Variable::start_proof(const Model & model, VariableID name, Proof & proof)
     proof.wrote_variable_takes_at_most_one_value(name, proof.last_model_line());
 }
 
+
+auto VariablePool::make_variable(int lb, int ub) -> shared_ptr<Variable>
+{
+    auto p = _ranges.find(pair{ lb, ub });
+    if (p == _ranges.end())
+        p = _ranges.emplace(pair{ lb, ub }, Variable{ lb, ub }).first;
+    return make_shared<Variable>(p->second);
+}
+
+auto VariablePool::make_variable(const set<int> & values) -> shared_ptr<Variable>
+{
+    auto p = _sets.find(values);
+    if (p == _sets.end())
+        p = _sets.emplace(values, Variable{ values }).first;
+    return make_shared<Variable>(p->second);
+}
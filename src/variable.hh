@@ -4,9 +4,11 @@
 #define GLASGOW_CONSTRAINT_SOLVER_GUARD_SRC_VARIABLE_HH 1
 
 #include "variable-fwd.hh"
+#include "domain.hh"
 #include "proof-fwd.hh"
 #include "model-fwd.hh"
 
+#include <map>
 #include <memory>
 #include <set>
 #include <utility>
@@ -15,13 +17,32 @@ struct Variable
 {
     Variable(int lw, int ub);
     explicit Variable(const std::set<int> & values);
+    explicit Variable(const std::shared_ptr<std::set<VariableValue> > & values);
     Variable(const Variable &);
     ~Variable();
 
+    // until something removes a value, values shares its representation
+    // with original_values
     std::shared_ptr<const std::set<VariableValue> > original_values;
-    std::set<VariableValue> values;
+    Domain values;
 
     auto start_proof(const Model & model, VariableID, Proof &) const -> void;
 };
 
+/**
+ * Makes variables, sharing the original values between every variable made
+ * with the same values, so that a model with lots of variables only has a
+ * few domains.
+ */
+class VariablePool
+{
+    private:
+        std::map<std::pair<int, int>, Variable> _ranges;
+        std::map<std::set<int>, Variable> _sets;
+
+    public:
+        auto make_variable(int lb, int ub) -> std::shared_ptr<Variable>;
+        auto make_variable(const std::set<int> & values) -> std::shared_ptr<Variable>;
+};
+
 #endif